@@ -0,0 +1,483 @@
+// Benchmarks for dvk's hot paths on generated trees.
+//
+//   dvk_bench [--filter <text>] [--json <file>] [--min-time <seconds>] [--scale <n>] [--keep]
+//
+// Every case runs until --min-time has passed (at least 3 iterations) and reports the
+// median wall time per iteration. --json writes the results in Google Benchmark's JSON
+// layout, so its compare tooling can diff two runs. The synthetic trees are created under
+// $TMPDIR and removed afterwards unless --keep is given; --scale multiplies their size.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <sys/utsname.h>
+
+#include "execute.hpp"
+#include "findNreplace.hpp"
+#include "glob.hpp"
+#include "jobpool.hpp"
+#include "print.hpp"
+#include "ProjectCloner.hpp"
+#include "ProjectCreator.hpp"
+#include "SourceMangler.hpp"
+#include "template.hpp"
+
+std::mutex g_output_mutex;
+
+namespace {
+    // Same list ProjectCloner prunes with
+    const std::vector<std::string> kPatterns = {
+        "build", "Build", "cmake-build-*", "out", "bin", "obj", "node_modules",
+        "__pycache__", ".pytest_cache", "target", "dist", ".git", ".svn", ".hg",
+        ".vscode", ".idea", "*.swp", "*.swo", "*~", "*.o", "*.obj", "*.exe",
+        "*.dll", "*.so", "*.dylib", "*.class", "*.pyc", "*.pyo", ".tmp", "*.tmp",
+        "*.temp", ".DS_Store", "Thumbs.db", "*.log", "logs"
+    };
+    // Keeps results the timed code computes from being optimised away
+    volatile uint64_t g_sink = 0;
+
+    const std::unordered_set<std::string> kIgnoredDirs = {"build", ".git", "node_modules", "cmake-build-debug"};
+
+    struct Options {
+        std::string filter;
+        std::string json_path;
+        double min_time = 0.5;
+        unsigned scale = 1;
+        bool keep = false;
+    };
+
+    struct Case {
+        std::string name;
+        std::function<uint64_t()> run;  // Timed; returns the items it processed
+        std::function<void()> setup{};  // Untimed, before every iteration
+        std::function<void()> teardown{}; // Untimed, after every iteration
+        uint64_t bytes = 0;             // Bytes moved per iteration, when meaningful
+    };
+
+    struct Result {
+        std::string name;
+        size_t iterations;
+        double median_ns, mean_ns, min_ns, max_ns, stddev_ns, cpu_ns;
+        uint64_t items;
+        uint64_t bytes;
+    };
+
+    uint64_t cpuNs() {
+        timespec ts{};
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    Result measure(const Case& c, const double min_time) {
+        std::vector<double> samples;
+        uint64_t items = 0;
+        double cpu = 0, total = 0;
+        // One untimed warm-up iteration fills caches and lazily built tables
+        for (bool warmup = true; warmup || samples.size() < 3 || total < min_time * 1e9; warmup = false) {
+            if (c.setup) c.setup();
+            const uint64_t cpu_start = cpuNs();
+            const auto start = std::chrono::steady_clock::now();
+            const uint64_t n = c.run();
+            const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            const uint64_t cpu_used = cpuNs() - cpu_start;
+            if (c.teardown) c.teardown();
+            if (warmup) continue;
+            samples.push_back(ns);
+            items = n;
+            total += ns;
+            cpu += static_cast<double>(cpu_used);
+            if (samples.size() >= 100000) break;
+        }
+
+        Result r{c.name, samples.size(), 0, 0, 0, 0, 0, cpu / static_cast<double>(samples.size()), items, c.bytes};
+        std::vector<double> sorted = samples;
+        std::ranges::sort(sorted);
+        r.median_ns = sorted[sorted.size() / 2];
+        r.min_ns = sorted.front();
+        r.max_ns = sorted.back();
+        r.mean_ns = total / static_cast<double>(samples.size());
+        double var = 0;
+        for (const double s : samples) var += (s - r.mean_ns) * (s - r.mean_ns);
+        r.stddev_ns = std::sqrt(var / static_cast<double>(samples.size()));
+        return r;
+    }
+
+    std::string humanTime(const double ns) {
+        if (ns < 1e3) return fmt::format("{:.1f} ns", ns);
+        if (ns < 1e6) return fmt::format("{:.2f} us", ns / 1e3);
+        if (ns < 1e9) return fmt::format("{:.2f} ms", ns / 1e6);
+        return fmt::format("{:.2f} s", ns / 1e9);
+    }
+
+    std::string jsonEscape(const std::string_view s) {
+        std::string out;
+        for (const char c : s) {
+            if (c == '"' || c == '\\') out.push_back('\\');
+            out.push_back(c);
+        }
+        return out;
+    }
+
+    bool writeJson(const std::string& path, const std::vector<Result>& results, const Options& options) {
+        FILE* out = fopen(path.c_str(), "w");
+        if (!out) return false;
+        utsname uts{};
+        uname(&uts);
+        const auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        char date[32];
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+        fmt::memory_buffer json;
+        auto it = std::back_inserter(json);
+        fmt::format_to(it, "{{\n  \"context\": {{\n    \"date\": \"{}\",\n    \"host_name\": \"{}\",\n"
+                           "    \"executable\": \"dvk_bench\",\n    \"num_cpus\": {},\n    \"scale\": {},\n"
+                           "    \"kernel\": \"{}\"\n  }},\n  \"benchmarks\": [",
+                       date, jsonEscape(uts.nodename), std::thread::hardware_concurrency(), options.scale,
+                       jsonEscape(uts.release));
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            fmt::format_to(it, "{}\n    {{\n      \"name\": \"{}\",\n      \"run_type\": \"iteration\",\n"
+                               "      \"iterations\": {},\n      \"real_time\": {:.1f},\n      \"cpu_time\": {:.1f},\n"
+                               "      \"time_unit\": \"ns\",\n      \"mean_time\": {:.1f},\n      \"min_time\": {:.1f},\n"
+                               "      \"max_time\": {:.1f},\n      \"stddev_time\": {:.1f},\n      \"items_per_second\": {:.1f}",
+                           i ? "," : "", jsonEscape(r.name), r.iterations, r.median_ns, r.cpu_ns, r.mean_ns,
+                           r.min_ns, r.max_ns, r.stddev_ns, static_cast<double>(r.items) / (r.median_ns / 1e9));
+            if (r.bytes) {
+                fmt::format_to(it, ",\n      \"bytes_per_second\": {:.1f}", static_cast<double>(r.bytes) / (r.median_ns / 1e9));
+            }
+            fmt::format_to(it, "\n    }}");
+        }
+        fmt::format_to(it, "\n  ]\n}}\n");
+        fwrite(json.data(), 1, json.size(), out);
+        const bool ok = !ferror(out);
+        return fclose(out) == 0 && ok;
+    }
+
+    // ---- Synthetic trees ----
+
+    void writeBytes(const fs::path& path, const size_t size, std::mt19937& rng) {
+        std::string data(size, '\0');
+        for (auto& c : data) c = static_cast<char>('a' + rng() % 26);
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f) throw std::runtime_error("cannot create " + path.string());
+        fwrite(data.data(), 1, data.size(), f);
+        fclose(f);
+    }
+
+    // Returns the total bytes of regular files written
+    uint64_t makeSmallFiles(const fs::path& root, const unsigned dirs, const unsigned files_per_dir, std::mt19937& rng) {
+        static const char* exts[] = {".cpp", ".hpp", ".c", ".h", ".o", ".md", ".txt", ".log", ".swp"};
+        uint64_t bytes = 0;
+        for (unsigned d = 0; d < dirs; ++d) {
+            const fs::path dir = root / fmt::format("module{}", d);
+            fs::create_directories(dir / "build");
+            writeBytes(dir / "build" / "artifact.o", 4096, rng);
+            for (unsigned f = 0; f < files_per_dir; ++f) {
+                const size_t size = 256 + rng() % 4096;
+                writeBytes(dir / fmt::format("file{}{}", f, exts[rng() % std::size(exts)]), size, rng);
+                bytes += size;
+            }
+        }
+        return bytes;
+    }
+
+    void makeDeep(const fs::path& dir, const unsigned depth, const unsigned fanout, std::mt19937& rng) {
+        fs::create_directories(dir);
+        writeBytes(dir / "node.cpp", 128, rng);
+        writeBytes(dir / "node.h", 64, rng);
+        if (depth == 0) return;
+        for (unsigned i = 0; i < fanout; ++i) makeDeep(dir / fmt::format("d{}", i), depth - 1, fanout, rng);
+    }
+
+    struct Trees {
+        fs::path root;
+        fs::path small;   // Many small files, some excluded build output
+        fs::path deep;    // Narrow and deep
+        fs::path wide;    // One huge directory
+        fs::path huge;    // A few large files
+        fs::path csrc;    // A C project for dvk mangle
+        fs::path workspace;
+        uint64_t small_bytes = 0;
+        uint64_t huge_bytes = 0;
+    };
+
+    // C files that call each other; `a * abs(b)` is a product, not a declaration of abs
+    void makeCSources(const fs::path& root, const unsigned files) {
+        fs::create_directories(root / "include");
+        std::string header = "#pragma once\n";
+        for (unsigned i = 0; i < files; ++i) header += fmt::format("int mod{}_run(int a, int b);\n", i);
+        FILE* h = fopen((root / "include" / "mods.h").c_str(), "w");
+        if (!h) throw std::runtime_error("cannot create " + root.string());
+        fputs(header.c_str(), h);
+        fclose(h);
+        for (unsigned i = 0; i < files; ++i) {
+            const std::string text = fmt::format(
+                "#include <stdlib.h>\n#include \"include/mods.h\"\n\n"
+                "/* mod{0}_helper(x) in a comment stays */\n"
+                "static int mod{0}_helper(int x) {{ return x * 3; }}\n\n"
+                "int mod{0}_run(int a, int b) {{\n"
+                "    int r = a * abs(b);\n"
+                "    const char *s = \"mod{0}_helper(1)\";\n"
+                "    return r + mod{0}_helper(a) + (int)s[0] + mod{1}_run(a, 0) * 0;\n}}\n",
+                i, (i + 1) % files);
+            FILE* f = fopen((root / fmt::format("mod{}.c", i)).c_str(), "w");
+            if (!f) throw std::runtime_error("cannot create " + root.string());
+            fputs(text.c_str(), f);
+            fclose(f);
+        }
+    }
+
+    Trees makeTrees(const unsigned scale) {
+        const char* tmp = std::getenv("TMPDIR");
+        std::string pattern = std::string(tmp && *tmp ? tmp : "/tmp") + "/dvk_bench.XXXXXX";
+        if (!mkdtemp(pattern.data())) throw std::runtime_error("mkdtemp failed");
+        Trees t;
+        t.root = pattern;
+        std::mt19937 rng(42);
+
+        t.small = t.root / "small";
+        t.small_bytes = makeSmallFiles(t.small, 50 * scale, 40, rng);
+        t.deep = t.root / "deep";
+        makeDeep(t.deep, 9 + (scale > 1 ? 1 : 0), 2, rng);
+        t.wide = t.root / "wide";
+        makeSmallFiles(t.wide, 1, 10000 * scale, rng);
+        t.huge = t.root / "huge";
+        fs::create_directories(t.huge);
+        for (int i = 0; i < 3; ++i) {
+            const size_t size = (32u << 20) * scale;
+            writeBytes(t.huge / fmt::format("blob{}.bin", i), size, rng);
+            t.huge_bytes += size;
+        }
+        t.csrc = t.root / "csrc";
+        makeCSources(t.csrc, 200 * scale);
+        t.workspace = t.root / "workspace";
+        fs::create_directories(t.workspace);
+        return t;
+    }
+
+    // ---- Cases ----
+
+    std::vector<std::string> makeNames(const size_t count) {
+        const std::vector<std::string> stems = {"main", "util", "parser", "lexer", "test_io", "README", "config", "node"};
+        const std::vector<std::string> exts = {".cpp", ".hpp", ".c", ".h", ".o", ".md", ".txt", ".log", ".swp", "", "~"};
+        std::mt19937 rng(42);
+        std::vector<std::string> names;
+        names.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            if (rng() % 16 == 0) {
+                names.emplace_back(rng() % 2 ? "cmake-build-debug" : "build");
+                continue;
+            }
+            names.push_back(stems[rng() % stems.size()] + std::to_string(rng() % 1000) + exts[rng() % exts.size()]);
+        }
+        return names;
+    }
+
+    // Runs a dvk clone of project with the given flags, the way `dvk clone` would
+    Case cloneCase(const std::string& name, const fs::path& project, std::vector<std::string> flags, const uint64_t bytes,
+                   const bool keep_first = false) {
+        auto counter = std::make_shared<unsigned>(0);
+        auto made = std::make_shared<std::vector<fs::path>>();
+        Case c;
+        c.name = name;
+        c.bytes = bytes;
+        c.run = [project, flags, counter, made] {
+            const std::string suffix = fmt::format("bench{}", (*counter)++);
+            std::vector<std::string> args = {"dvk", "clone"};
+            args.insert(args.end(), flags.begin(), flags.end());
+            args.push_back(suffix);
+            std::vector<char*> argv;
+            for (auto& a : args) argv.push_back(a.data());
+            argv.push_back(nullptr);
+
+            const fs::path previous = fs::current_path();
+            fs::current_path(project);
+            ProjectCloner cloner(static_cast<int>(args.size()), argv.data(), "clone");
+            cloner.run();
+            fs::current_path(previous);
+            const bool compressed = std::ranges::find(flags, "-c") != flags.end();
+            made->push_back(project.parent_path() / (project.filename().string() + "_" + suffix + (compressed ? ".tar.gz" : "")));
+            return uint64_t{1};
+        };
+        // Incremental clones keep the first snapshot around as their base
+        c.teardown = [made, keep_first] {
+            for (size_t i = keep_first ? 1 : 0; i < made->size(); ++i) fs::remove_all((*made)[i]);
+            if (made->size() > (keep_first ? 1u : 0u)) made->resize(keep_first ? 1 : 0);
+        };
+        return c;
+    }
+
+    std::vector<Case> makeCases(const Trees& t) {
+        std::vector<Case> cases;
+
+        for (const auto& [label, dir] : {std::pair{"small", t.small}, {"deep", t.deep}, {"wide", t.wide}}) {
+            cases.push_back({fmt::format("find_source_files/{}", label), [dir] {
+                return static_cast<uint64_t>(find_source_files(dir, kIgnoredDirs, {"*_test.cpp"}).size());
+            }});
+        }
+
+        auto names = std::make_shared<std::vector<std::string>>(makeNames(20000));
+        cases.push_back({"matches_pattern/20k_names", [names] {
+            uint64_t hits = 0;
+            for (const auto& name : *names) {
+                for (const auto& p : kPatterns) {
+                    if (matches_pattern(name, p)) {
+                        ++hits;
+                        break;
+                    }
+                }
+            }
+            g_sink = hits;
+            return static_cast<uint64_t>(names->size());
+        }});
+        auto set = std::make_shared<GlobSet>(kPatterns);
+        cases.push_back({"GlobSet/20k_names", [names, set] {
+            uint64_t hits = 0;
+            for (const auto& name : *names) hits += set->matches(name) ? 1 : 0;
+            g_sink = hits;
+            return static_cast<uint64_t>(names->size());
+        }});
+
+        cases.push_back({"execute_vec/true", [] {
+            return static_cast<uint64_t>(execute_vec({"true"}).exit_code == 0);
+        }});
+        cases.push_back({"execute_vec/seq_100k_lines", [] {
+            return static_cast<uint64_t>(execute_vec({"seq", "1", "100000"}).stdout_output.size());
+        }});
+        // 64 times execute_vec/true, with as many in flight as there are hardware threads
+        cases.push_back({"JobPool/64_true", [] {
+            const std::vector<JobPool::Command> commands(64, JobPool::Command{"true"});
+            uint64_t ok = 0;
+            for (const CommandResult& result : JobPool().run(commands)) ok += result.exit_code == 0;
+            return ok;
+        }});
+
+        auto text = std::make_shared<std::string>();
+        for (int i = 0; i < 20000; ++i) *text += "project {{NAME}} uses {{BUILD}} and {{NAME}} again; ";
+        cases.push_back({"findAndReplaceAll/1MB_template", [text] {
+            std::string data = *text;
+            findAndReplaceAll(data, "{{NAME}}", "benchmark_project");
+            findAndReplaceAll(data, "{{BUILD}}", "cmake");
+            g_sink = data.size();
+            return static_cast<uint64_t>(1);
+        }, {}, {}, text->size()});
+        cases.push_back({"tmpl::render/1MB_template", [text] {
+            const std::string data = tmpl::render<2>(*text, {"{{NAME}}", "{{BUILD}}"}, {"benchmark_project", "cmake"});
+            g_sink = data.size();
+            return static_cast<uint64_t>(1);
+        }, {}, {}, text->size()});
+
+        auto sink = std::shared_ptr<FILE>(fopen("/dev/null", "w"), [](FILE* f) { if (f) fclose(f); });
+        cases.push_back({"print::log_impl/10k_lines", [sink] {
+            for (int i = 0; i < 10000; ++i) {
+                print::log_impl(COLOR_INFO, sink.get(), "[INFO]", "copied '{}' ({} bytes)", "src/module/file.cpp", i);
+            }
+            return uint64_t{10000};
+        }});
+
+        cases.push_back(cloneCase("clone/copy/small", t.small, {}, t.small_bytes));
+        cases.push_back(cloneCase("clone/copy/huge", t.huge, {}, t.huge_bytes));
+        cases.push_back(cloneCase("clone/compress/small", t.small, {"-c"}, t.small_bytes));
+        cases.push_back(cloneCase("clone/incremental/small", t.small, {"-i"}, t.small_bytes, true));
+
+        // Every iteration mangles from scratch; the first one also checks the result
+        const fs::path csrc = t.csrc;
+        auto checked = std::make_shared<bool>(false);
+        cases.push_back({"mangle/200_c_files", [csrc, checked] {
+            const std::string out = (csrc.parent_path() / "csrc_mangled").string();
+            std::vector<std::string> args = {"dvk", "mangle", csrc.string(), "-o", out, "--seed", "1", "--rebuild"};
+            std::vector<char*> argv;
+            for (auto& a : args) argv.push_back(a.data());
+            argv.push_back(nullptr);
+            SourceMangler mangler(static_cast<int>(args.size()), argv.data());
+            if (mangler.run() != 0) throw std::runtime_error("dvk mangle failed");
+            if (!*checked) {
+                std::ifstream map(fs::path(out) / "_mangling_map.json");
+                const std::string json((std::istreambuf_iterator<char>(map)), std::istreambuf_iterator<char>());
+                // Regression: `a * abs(b)` once made abs look like a declaration
+                if (json.find("\"abs\"") != std::string::npos || json.find("\"mod0_run\"") == std::string::npos) {
+                    fmt::print(stderr, "mangle/200_c_files: wrong mapping:\n{}\n", json.substr(0, 400));
+                    std::exit(1);
+                }
+                *checked = true;
+            }
+            return uint64_t{1};
+        }, {}, [csrc] { fs::remove_all(csrc.parent_path() / "csrc_mangled"); }});
+
+        // The interactive wizard, driven through a scripted stdin
+        auto counter = std::make_shared<unsigned>(0);
+        const fs::path workspace = t.workspace;
+        cases.push_back({"create/cpp_cmake", [workspace, counter] {
+            // name, type (C++), workspace (the current directory), build system (CMake), confirm
+            std::istringstream script(fmt::format("proj{}\n2\n1\n2\ny\n", (*counter)++));
+            auto* saved = std::cin.rdbuf(script.rdbuf());
+            const fs::path previous = fs::current_path();
+            fs::current_path(workspace);
+            ProjectCreator creator;
+            creator.run();
+            fs::current_path(previous);
+            std::cin.rdbuf(saved);
+            return uint64_t{1};
+        }, {}, [workspace] {
+            for (const auto& entry : fs::directory_iterator(workspace)) fs::remove_all(entry.path());
+        }});
+        return cases;
+    }
+}
+
+int main(const int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--filter" && has_value) options.filter = argv[++i];
+        else if (arg == "--json" && has_value) options.json_path = argv[++i];
+        else if (arg == "--min-time" && has_value) options.min_time = std::stod(argv[++i]);
+        else if (arg == "--scale" && has_value) options.scale = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--keep") options.keep = true;
+        else {
+            fmt::print(stderr, "Usage: {} [--filter <text>] [--json <file>] [--min-time <seconds>] [--scale <n>] [--keep]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // The code under test logs; only its warnings and errors are of interest here
+    print::set_level(print::Level::Warn);
+    // The create wizard suggests workspaces under $HOME: point it somewhere empty
+    const Trees trees = makeTrees(options.scale);
+    setenv("HOME", trees.workspace.c_str(), 1);
+    fmt::print("Synthetic trees in {}\n", trees.root.string());
+
+    std::vector<Result> results;
+    fmt::print("{:<34} {:>12} {:>12} {:>12} {:>8} {:>14}\n", "benchmark", "median", "min", "cpu", "iters", "throughput");
+    for (const Case& c : makeCases(trees)) {
+        if (!options.filter.empty() && c.name.find(options.filter) == std::string::npos) continue;
+        const Result r = measure(c, options.min_time);
+        const double per_second = 1e9 / r.median_ns;
+        const std::string throughput = r.bytes
+            ? fmt::format("{:.1f} MB/s", static_cast<double>(r.bytes) * per_second / 1e6)
+            : fmt::format("{:.3g} items/s", static_cast<double>(r.items) * per_second);
+        fmt::print("{:<34} {:>12} {:>12} {:>12} {:>8} {:>14}\n", r.name, humanTime(r.median_ns), humanTime(r.min_ns),
+                   humanTime(r.cpu_ns), r.iterations, throughput);
+        results.push_back(r);
+    }
+
+    if (!options.keep) fs::remove_all(trees.root);
+    if (!options.json_path.empty()) {
+        if (!writeJson(options.json_path, results, options)) {
+            fmt::print(stderr, "Failed to write {}\n", options.json_path);
+            return 1;
+        }
+        fmt::print("Results written to {}\n", options.json_path);
+    }
+    return 0;
+}
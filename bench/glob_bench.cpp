@@ -0,0 +1,67 @@
+// Microbenchmark: GlobSet against the per-pattern matches_pattern loop.
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <fmt/core.h>
+
+#include "execute.hpp"
+#include "glob.hpp"
+
+std::mutex g_output_mutex;
+
+namespace {
+    // Same list ProjectCloner prunes with
+    const std::vector<std::string> kPatterns = {
+        "build", "Build", "cmake-build-*", "out", "bin", "obj", "node_modules",
+        "__pycache__", ".pytest_cache", "target", "dist", ".git", ".svn", ".hg",
+        ".vscode", ".idea", "*.swp", "*.swo", "*~", "*.o", "*.obj", "*.exe",
+        "*.dll", "*.so", "*.dylib", "*.class", "*.pyc", "*.pyo", ".tmp", "*.tmp",
+        "*.temp", ".DS_Store", "Thumbs.db", "*.log", "logs"
+    };
+
+    std::vector<std::string> makeNames(const size_t count) {
+        const std::vector<std::string> stems = {"main", "util", "parser", "lexer", "test_io", "README", "config", "node"};
+        const std::vector<std::string> exts = {".cpp", ".hpp", ".c", ".h", ".o", ".md", ".txt", ".log", ".swp", "", "~"};
+        std::mt19937 rng(42);
+        std::vector<std::string> names;
+        names.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            if (rng() % 16 == 0) {
+                names.emplace_back(rng() % 2 ? "cmake-build-debug" : "build");
+                continue;
+            }
+            names.push_back(stems[rng() % stems.size()] + std::to_string(rng() % 1000) + exts[rng() % exts.size()]);
+        }
+        return names;
+    }
+
+    template<typename F>
+    void run(const char* label, const std::vector<std::string>& names, const int rounds, F&& match) {
+        size_t hits = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (const auto& name : names) hits += match(name) ? 1 : 0;
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        const double per_name = elapsed.count() / static_cast<double>(names.size() * rounds);
+        fmt::print("{:<16} {:>8.1f} ns/name  ({} matches)\n", label, per_name, hits);
+    }
+}
+
+int main(const int argc, char* argv[]) {
+    const size_t count = argc > 1 ? std::stoul(argv[1]) : 200000;
+    constexpr int rounds = 5;
+    const auto names = makeNames(count);
+    const GlobSet set(kPatterns);
+
+    fmt::print("{} names x {} patterns, {} rounds\n", names.size(), kPatterns.size(), rounds);
+    run("matches_pattern", names, rounds, [](const std::string& name) {
+        for (const auto& p : kPatterns) {
+            if (matches_pattern(name, p)) return true;
+        }
+        return false;
+    });
+    run("GlobSet", names, rounds, [&set](const std::string& name) { return set.matches(name); });
+    return 0;
+}
@@ -2,7 +2,9 @@
 #include "ProjectCreator.hpp"
 #include "AutoInstaller.hpp"
 #include "ProjectCloner.hpp"
+#include "SourceMangler.hpp"
 #include "print.hpp"
+#include "profile.hpp"
 
 #define TIME __TIME__
 #define DATE __DATE__
@@ -15,18 +17,23 @@ public:
         const std::string cmd = argv[1];
         if (cmd == "create") {
             try {
+                if (argc >= 3 && std::string_view(argv[2]) == "--batch") {
+                    return createBatch(argc, argv);
+                }
                 ProjectCreator wizard;
-                wizard.run();
+                return wizard.run();
             } catch (...) {
                 print::error("A critical error has occurred.");
                 return 1;
             }
-            return 0;
         }
         if (cmd == "install") {
             try {
+                if (argc >= 3 && std::string_view(argv[2]) == "--batch") {
+                    return installBatch(argc, argv);
+                }
                 AutoInstaller install;
-                install.run(argv[2], argv[3]);
+                install.run(argc > 2 ? argv[2] : nullptr, argc > 3 ? argv[3] : nullptr);
             } catch (...) {
                 print::error("A critical error has occurred.");
                 return 1;
@@ -41,6 +48,26 @@ public:
                 return 1;
             }
         }
+        if (cmd == "mangle") {
+            try {
+                SourceMangler mangler(argc, argv);
+                return mangler.run();
+            } catch (...) {
+                print::error("A critical error has occurred.");
+                return 1;
+            }
+        }
+        if (cmd == "logdump") {
+            if (argc < 3) {
+                print::error("Usage: dvk logdump <binary-log>");
+                return 1;
+            }
+            if (!print::binlog::decode(argv[2], stdout)) {
+                print::error("'{}' is not a dvk binary log", argv[2]);
+                return 1;
+            }
+            return 0;
+        }
         if (cmd == "help") {
             try {
                 help();
@@ -66,20 +93,120 @@ public:
         }
         return 0;
     }
+    // dvk create --batch <manifest.toml> [-j <threads>]
+    static int createBatch(const int argc, char* argv[]) {
+        if (argc < 4) {
+            print::error("Usage: dvk create --batch <manifest.toml> [-j <threads>]");
+            return 1;
+        }
+        unsigned threads = 0;
+        if (argc >= 6 && std::string_view(argv[4]) == "-j") {
+            threads = static_cast<unsigned>(std::max(0, std::atoi(argv[5])));
+        }
+        return ProjectCreator::runBatch(argv[3], threads);
+    }
+
+    // dvk install --batch <dir|manifest.toml> [--to <dir>] [-j <threads>]
+    static int installBatch(const int argc, char* argv[]) {
+        if (argc < 4) {
+            print::error("Usage: dvk install --batch <dir|manifest.toml> [--to <dir>] [-j <threads>]");
+            return 1;
+        }
+        if (argc % 2 != 0) {
+            print::error("Missing value for '{}'", argv[argc - 1]);
+            return 1;
+        }
+        std::string target;
+        unsigned threads = 0;
+        for (int i = 4; i + 1 < argc; i += 2) {
+            const std::string_view option(argv[i]);
+            if (option == "--to") {
+                target = argv[i + 1];
+            } else if (option == "-j") {
+                threads = static_cast<unsigned>(std::max(0, std::atoi(argv[i + 1])));
+            } else {
+                print::error("Unknown option '{}'", option);
+                return 1;
+            }
+        }
+        return AutoInstaller::runBatch(argv[3], target, threads);
+    }
+
     static void help() {
         print::info("DVK v0.0.1 compile on {} at {}.", DATE, TIME);
         print::info("Commands:");
-        print::info("\t install");
-        print::info("\t create");
+        print::info("\t install [--batch <dir|manifest.toml> [--to <dir>] [-j <threads>]]");
+        print::info("\t   --to overrides a manifest's [defaults] target, not a [[file]]'s own target");
+        print::info("\t create [--batch <manifest.toml> [-j <threads>]]");
+        print::info("\t clone");
+        print::info("\t mangle <source-dir> [-o <dir>] [--protect <names>...] [--seed <n>] [--rebuild] [-j <threads>]");
+        print::info("\t logdump <file>");
+        print::info("Options (before the command): --profile, --trace-out <file.json>");
+        print::info("Environment: DVK_LOG_LEVEL=trace|debug|info|warn|error|off, DVK_BINLOG=<file>");
+    }
+
+    // Runtime logging setup; the environment keeps it out of every command's arguments
+    static void configureLogging() {
+        if (const char* level = std::getenv("DVK_LOG_LEVEL")) {
+            print::Level parsed;
+            if (print::parse_level(level, parsed)) {
+                print::set_level(parsed);
+            } else {
+                print::warn("Ignoring unknown DVK_LOG_LEVEL '{}'", level);
+            }
+        }
+        if (const char* path = std::getenv("DVK_BINLOG"); path && *path && !print::binlog::open(path)) {
+            print::warn("Cannot open binary log '{}': {}", path, std::strerror(errno));
+        }
     }
 };
 
-int main(const int argc, char * argv[]) {
+int main(int argc, char * argv[]) {
+    DVK::configureLogging();
+
+    // Global profiling options come before the command name and are taken out before the
+    // command parses its arguments; after the name they belong to the command
+    bool profiling = false;
+    std::string trace_path;
+    std::vector<char*> args(argv, argv + std::min(argc, 1));
+    int i = 1;
+    for (; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--profile") {
+            profiling = true;
+        } else if (arg == "--trace-out" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (arg.starts_with("--trace-out=")) {
+            trace_path = arg.substr(std::string_view("--trace-out=").size());
+        } else {
+            break;
+        }
+    }
+    args.insert(args.end(), argv + std::min(i, argc), argv + argc);
+    argc = static_cast<int>(args.size());
+    args.push_back(nullptr);
+    argv = args.data();
+    if (profiling || !trace_path.empty()) profile::enable(!trace_path.empty());
+    const auto start = std::chrono::steady_clock::now();
+
     if (argc < 2) {
         DVK::help();
         return 0;
     }
-    if (const int ec = DVK::start(argc, argv) != 0) {
+    const int ec = DVK::start(argc, argv);
+
+    if (profiling) {
+        profile::report(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count()));
+    }
+    if (!trace_path.empty()) {
+        if (profile::write_trace(trace_path)) {
+            print::info("Trace written to '{}'", trace_path);
+        } else {
+            print::error("Failed to write trace '{}': {}", trace_path, std::strerror(errno));
+        }
+    }
+    if (ec != 0) {
         print::error("dvk.start() failed with exitcode {}", ec);
         return ec;
     }
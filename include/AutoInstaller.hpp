@@ -22,6 +22,12 @@ public:
     // Individual operations
     bool install(const std::string& sourceFile, InstallMode mode = InstallMode::Copy, const std::string& customTargetDir = "");
 
+    // `dvk install --batch`: installs every file of a directory, or every [[file]] of a
+    // manifest (see runBatch in AutoInstaller.cpp), checking them all before touching
+    // anything. Each file is staged beside its target and renamed over it, so a running
+    // script never finds its command missing. Returns the process exit code.
+    static int runBatch(const fs::path& source, const std::string& targetDir = "", unsigned threads = 0);
+
 private:
     // Configuration
     std::string m_sourceFile;
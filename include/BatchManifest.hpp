@@ -0,0 +1,47 @@
+// BatchManifest.hpp
+#ifndef BATCH_MANIFEST_H
+#define BATCH_MANIFEST_H
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The TOML subset the --batch modes read:
+//
+//   # comment
+//   [defaults]            -- a table
+//   workspace = "~/services"
+//
+//   [[project]]           -- one entry of an array of tables
+//   name = "auth"
+//   threads = 4           -- bare values (numbers, true/false) are kept as text
+//
+// Strings take the basic escapes (\" \\ \n \t); inline tables, arrays, dotted keys
+// and multi-line strings are rejected with the line they appear on.
+class BatchManifest {
+public:
+    struct Table {
+        std::string name;
+        bool array = false; // [[name]] rather than [name]
+        int line = 0;
+        std::vector<std::pair<std::string, std::string>> values;
+
+        // Value for key, or nullptr
+        [[nodiscard]] const std::string* find(std::string_view key) const;
+    };
+
+    // Returns false with a "file:line: reason" message in error when path can't be read or parsed.
+    bool load(const std::filesystem::path& path, std::string& error);
+
+    [[nodiscard]] const std::vector<Table>& tables() const { return m_tables; }
+    // The [name] table, or nullptr
+    [[nodiscard]] const Table* table(std::string_view name) const;
+    // Every [[name]] entry, in file order
+    [[nodiscard]] std::vector<const Table*> array(std::string_view name) const;
+
+private:
+    std::vector<Table> m_tables; // Keys before the first header go in a table named ""
+};
+
+#endif // BATCH_MANIFEST_H
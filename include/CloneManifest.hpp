@@ -0,0 +1,51 @@
+// CloneManifest.hpp
+#ifndef CLONE_MANIFEST_H
+#define CLONE_MANIFEST_H
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <sys/types.h>
+
+// What an incremental clone remembers about one regular file.
+struct ManifestEntry {
+    uint64_t hash = 0;     // XXH64 of the contents
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    uint64_t inode = 0;
+    mode_t mode = 0;
+};
+
+// Per-project record of the last incremental snapshot, kept beside the backups as
+// ".<project>.dvk-manifest". One text line per file, so it can be inspected by hand.
+// dvk install keeps its record of installed files in the same format.
+class CloneManifest {
+public:
+    [[nodiscard]] static std::filesystem::path pathFor(const std::filesystem::path& parent, const std::string& project);
+
+    // Returns false when the file is missing or not a manifest.
+    bool load(const std::filesystem::path& path);
+    // Writes to a temporary file and renames it over path.
+    [[nodiscard]] bool save(const std::filesystem::path& path) const;
+
+    [[nodiscard]] const ManifestEntry* find(std::string_view rel) const;
+    void add(std::string rel, const ManifestEntry& entry);
+
+    [[nodiscard]] const std::string& snapshot() const { return m_snapshot; }
+    void setSnapshot(std::string name) { m_snapshot = std::move(name); }
+    [[nodiscard]] size_t size() const { return m_entries.size(); }
+
+private:
+    struct PathHash {
+        using is_transparent = void;
+        size_t operator()(const std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    std::string m_snapshot; // Backup directory name (relative to the parent) the entries describe
+    std::unordered_map<std::string, ManifestEntry, PathHash, std::equal_to<>> m_entries;
+};
+
+#endif // CLONE_MANIFEST_H
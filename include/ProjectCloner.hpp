@@ -4,6 +4,7 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 #include <filesystem>
 
 class ProjectCloner {
@@ -20,10 +21,10 @@ private:
     bool parseArguments();
     void validateEnvironment() const;
     bool prepareBackupDestination();
-    void performBackup() const;
-    void performRsyncBackup() const;
-    void performTarBackup() const;
-    void printFinalSummary() const;
+    void performBackup();
+    void performCopyBackup();
+    void performTarBackup();
+    void printFinalSummary();
 
     // --- Member Variables ---
     int m_argc;
@@ -32,6 +33,7 @@ private:
     // Configuration from args
     std::string m_suffix;
     bool m_compress = false;
+    bool m_incremental = false;
 
     // Path information
     std::filesystem::path m_currentPath;
@@ -40,6 +42,15 @@ private:
     std::string m_sourceDirName;
     std::string m_commandName;
 
+    // Counted by the copy/archive engines while they run
+    struct CloneStats {
+        uint64_t files = 0;
+        uint64_t bytes = 0;        // File data read from the source
+        uint64_t outputBytes = 0;  // Archive size (compressed mode only)
+        double seconds = 0;
+    };
+    CloneStats m_stats;
+
 };
 
 #endif // PROJECT_CLONER_H
\ No newline at end of file
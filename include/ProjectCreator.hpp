@@ -2,8 +2,11 @@
 #ifndef PROJECT_CREATOR_H
 #define PROJECT_CREATOR_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <filesystem>
+#include <vector>
 
 // C++17 filesystem alias
 namespace fs = std::filesystem;
@@ -12,8 +15,17 @@ class ProjectCreator {
 public:
     /**
      * @brief Runs the interactive project creation wizard.
+     * @return Process exit code: 0 when the project was created or the user cancelled.
      */
-    void run();
+    int run();
+
+    /**
+     * @brief Creates every [[project]] of a manifest without prompting (`dvk create --batch`).
+     * @param manifest TOML file listing the projects; see BatchManifest.hpp for the syntax.
+     * @param threads Projects created at once; 0 uses one per core.
+     * @return Process exit code: 0 when every project was created.
+     */
+    static int runBatch(const fs::path& manifest, unsigned threads = 0);
 
 private:
     // Enums for strongly-typed choices
@@ -37,8 +49,19 @@ private:
     static bool confirmSettings();
 
     // 2. Project & File System Operations
+    struct ProjectFile {
+        bool inSrc;       // Under src/ rather than the project root
+        const char* name;
+        std::string content;
+    };
+
+    [[nodiscard]] std::vector<ProjectFile> projectFiles() const;
     void createProjectStructure() const;
-    static void writeFile(const fs::path& path, const std::string& content);
+    // Writes the whole project into a new hidden directory of the workspace and returns
+    // its name. Throws on failure, after removing what it wrote.
+    [[nodiscard]] std::string stageProject(int workspace_fd, size_t& files, uint64_t& bytes) const;
+    // Renames a staged project to its final name; never replaces an existing entry.
+    void publishProject(int workspace_fd, const std::string& stage) const;
 
     // 3. Content Generation
     [[nodiscard]] static std::string getCMainContent() ;
@@ -47,7 +70,7 @@ private:
     [[nodiscard]] std::string getMakefileContent() const;
     [[nodiscard]] std::string getAutoccContent() const;
     [[nodiscard]] std::string getCMakeContent() const;
-    [[nodiscard]] static std::string getGitignoreContent() ;
+    [[nodiscard]] std::string getGitignoreContent() const;
     [[nodiscard]] std::string getReadmeContent() const;
 
     // 4. Utility Helpers
@@ -55,6 +78,8 @@ private:
     [[nodiscard]] static bool isValidProjectName(const std::string& name) ;
     [[nodiscard]] static std::string projectTypeToString(ProjectType type) ;
     [[nodiscard]] static std::string buildSystemToString(BuildSystem system);
+    [[nodiscard]] static ProjectType parseProjectType(std::string_view text);
+    [[nodiscard]] static BuildSystem parseBuildSystem(std::string_view text);
 
 };
 
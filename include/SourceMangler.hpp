@@ -0,0 +1,73 @@
+// SourceMangler.hpp
+#ifndef SOURCE_MANGLER_H
+#define SOURCE_MANGLER_H
+
+#include "SymbolMap.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// dvk mangle: renames a C project's functions to compiler-looking names, writing the
+// result to a copy of the tree plus the _mangling_map.json that scripts/mangle.py writes.
+//
+// Every file is lexed once to collect the functions it declares or defines, then once
+// more to rewrite them, both passes spread over all cores. Comments and string literals
+// are never touched, and the renaming table is a perfect hash, so each file costs one
+// linear pass however many names there are.
+//
+// The output directory keeps a SymbolMap of every name handed out and every file's
+// content hash. A later run reuses those names, extracts only files whose contents
+// changed, and rewrites only those plus unchanged files that use a name that appeared or
+// went away, so repeated builds are incremental and the mangled names stay put.
+class SourceMangler {
+public:
+    SourceMangler(int argc, char* argv[]);
+
+    // Returns the process exit code.
+    int run();
+
+private:
+    struct SourceFile {
+        std::string rel;                // Relative to the source directory
+        std::vector<std::string> names; // Functions it declares or defines, in order
+        uint64_t hash = 0;              // XXH64 of the contents
+        bool read = false;
+        bool changed = true;            // Not as the previous run saw it
+    };
+
+    bool parseArguments();
+    void showUsage() const;
+    bool collectFiles();
+    void extractAll();
+    void buildMapping();
+    bool rewriteAll();
+    bool saveMapping() const;
+    void removeStale(int out_fd) const;
+
+    [[nodiscard]] bool isMangleable(const std::string& name) const;
+    [[nodiscard]] std::string generateName(size_t length);
+
+    int m_argc;
+    char** m_argv;
+
+    std::filesystem::path m_sourceDir;
+    std::filesystem::path m_outputDir;
+    std::vector<std::string> m_extensions = {".c", ".h"};
+    std::unordered_set<std::string> m_protected;
+    unsigned m_threads = 0;
+    bool m_rebuild = false;
+    std::mt19937_64 m_random;
+
+    std::vector<SourceFile> m_files;
+    std::vector<std::pair<std::string, std::string>> m_mapping; // Original -> mangled, first seen first
+    std::vector<std::pair<std::string, std::string>> m_retired; // Earlier names no file declares now
+    std::vector<std::string> m_changedNames;                    // Mapped now but not before, or the reverse
+    SymbolMap m_previous;
+    size_t m_reused = 0;
+};
+
+#endif // SOURCE_MANGLER_H
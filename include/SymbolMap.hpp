@@ -0,0 +1,102 @@
+// SymbolMap.hpp
+#ifndef SYMBOL_MAP_H
+#define SYMBOL_MAP_H
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What dvk mangle remembers between runs, kept in the output directory as
+// "_mangling_map.dvkmap": every name it has ever handed out and, per source file, the
+// content hash and the functions the file declared. Reusing it keeps mangled names stable
+// and lets unchanged files be skipped.
+//
+// The file is memory-mapped and used in place, so loading it costs the same for ten
+// names or a million:
+//   "DVKSYM1\n", u32 symbol count, u32 symbol slots, u32 file count, u32 file slots,
+//   u32 reference count, u32 arena size,
+//   symbols x { u32 name offset, u32 name size, u32 mangled offset, u32 mangled size, u32 hash, u32 flags },
+//   u32 symbol slots (index + 1, 0 when free),
+//   files x { u64 content hash, u32 path offset, u32 path size, u32 first reference, u32 reference count, u32 hash, u32 unused },
+//   u32 file slots, u32 references (symbol indices), string arena
+// Both slot tables are open-addressed with linear probing over a power-of-two size kept
+// at most half full. Symbols keep the order they were first mangled in.
+class SymbolMap {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    struct FileRecord {
+        uint64_t hash = 0;                 // XXH64 of the source contents
+        std::span<const uint32_t> symbols; // Declared functions, as symbol indices
+    };
+
+    [[nodiscard]] static std::filesystem::path pathFor(const std::filesystem::path& output_dir);
+
+    SymbolMap() = default;
+    ~SymbolMap();
+    SymbolMap(const SymbolMap&) = delete;
+    SymbolMap& operator=(const SymbolMap&) = delete;
+
+    // Maps the file read-only. False when it is missing or not a symbol map, leaving the map empty.
+    bool load(const std::filesystem::path& path);
+
+    [[nodiscard]] uint32_t symbols() const { return m_symbolCount; }
+    [[nodiscard]] uint32_t findSymbol(std::string_view name) const;
+    [[nodiscard]] std::string_view name(uint32_t symbol) const;
+    [[nodiscard]] std::string_view mangled(uint32_t symbol) const;
+    // Whether a source file declared the symbol in the run that wrote the map
+    [[nodiscard]] bool active(uint32_t symbol) const;
+
+    [[nodiscard]] uint32_t files() const { return m_fileCount; }
+    [[nodiscard]] bool findFile(std::string_view rel, FileRecord& out) const;
+    [[nodiscard]] std::string_view filePath(uint32_t file) const;
+
+    // Collects a new map; symbols must be distinct, as must files.
+    class Writer {
+    public:
+        uint32_t addSymbol(std::string_view name, std::string_view mangled, bool active);
+        void addFile(std::string_view rel, uint64_t hash, std::span<const uint32_t> symbols);
+        // Writes to a temporary file and renames it over path; returns 0 or an errno value.
+        [[nodiscard]] int save(const std::filesystem::path& path) const;
+
+    private:
+        uint32_t append(std::string_view text);
+
+        std::vector<uint32_t> m_symbols; // Six words per symbol, as in the file
+        std::vector<uint32_t> m_files;   // Eight words per file
+        std::vector<uint32_t> m_refs;
+        std::string m_arena;
+    };
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t symbol_count;
+        uint32_t symbol_slots;
+        uint32_t file_count;
+        uint32_t file_slots;
+        uint32_t ref_count;
+        uint32_t arena_size;
+    };
+
+    [[nodiscard]] std::string_view text(uint32_t offset, uint32_t size) const;
+
+    void* m_data = nullptr;
+    size_t m_size = 0;
+    uint32_t m_symbolCount = 0;
+    uint32_t m_symbolSlots = 0;
+    uint32_t m_fileCount = 0;
+    uint32_t m_fileSlots = 0;
+    uint32_t m_refCount = 0;
+    const uint32_t* m_symbols = nullptr;
+    const uint32_t* m_symbolTable = nullptr;
+    const uint32_t* m_files = nullptr;
+    const uint32_t* m_fileTable = nullptr;
+    const uint32_t* m_refs = nullptr;
+    std::string_view m_arena;
+};
+
+#endif // SYMBOL_MAP_H
@@ -0,0 +1,85 @@
+// TarArchiver.hpp
+#ifndef TAR_ARCHIVER_H
+#define TAR_ARCHIVER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+// Streams entries into a .tar.gz file. The tar stream is cut into fixed-size
+// chunks that worker threads compress independently as separate gzip members
+// (pigz-style); the members are written back in order, which any gzip reader
+// decodes as one stream.
+class TarArchiver {
+public:
+    explicit TarArchiver(std::filesystem::path output, unsigned threads = 0, int level = -1);
+    ~TarArchiver();
+
+    TarArchiver(const TarArchiver&) = delete;
+    TarArchiver& operator=(const TarArchiver&) = delete;
+
+    // Creates the output file and starts the compression workers.
+    [[nodiscard]] bool open();
+
+    void addDirectory(const std::string& name, const struct stat& st);
+    void addSymlink(const std::string& name, const std::string& target, const struct stat& st);
+    // Streams st.st_size bytes from fd; a file that shrinks meanwhile is zero-padded.
+    [[nodiscard]] bool addFile(int fd, const std::string& name, const struct stat& st);
+
+    // Writes the end-of-archive marker, waits for compression and closes the file.
+    [[nodiscard]] bool finish();
+
+    // Whether a chunk failed to compress or write; later entries are dropped and finish() fails.
+    [[nodiscard]] bool failed() const { return m_failed; }
+    [[nodiscard]] uint64_t inputBytes() const { return m_inputBytes; }
+    [[nodiscard]] uint64_t outputBytes() const { return m_outputBytes; }
+
+private:
+    struct Job {
+        std::vector<unsigned char> raw;
+        std::vector<unsigned char> packed;
+        bool done = false;
+        bool ok = false;
+    };
+
+    void writeHeader(const std::string& name, const struct stat& st, char type, uint64_t size, const std::string& link = "");
+    void writePaxHeader(const std::string& name, const std::vector<std::pair<std::string, std::string>>& records);
+    void append(const void* data, size_t size);
+    void padToBlock();
+    void submitChunk();
+    bool writeCompleted(bool wait_for_next);
+    bool writeOut(const unsigned char* data, size_t size);
+    bool flushOutput();
+    void worker();
+    static bool compress(Job& job, int level);
+
+    std::filesystem::path m_output;
+    unsigned m_threads;
+    int m_level;
+    int m_fd = -1;
+    bool m_failed = false;
+
+    std::vector<unsigned char> m_chunk;  // Tar bytes not yet handed to a worker
+    std::vector<unsigned char> m_outBuf; // Compressed bytes waiting for a large write
+    uint64_t m_streamOffset = 0;         // Position in the uncompressed tar stream
+    uint64_t m_inputBytes = 0;
+    uint64_t m_outputBytes = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::map<uint64_t, Job> m_jobs; // In flight, keyed by sequence number
+    std::deque<uint64_t> m_queue;   // Sequence numbers waiting for a worker
+    uint64_t m_nextSeq = 0;
+    uint64_t m_nextWrite = 0;
+    bool m_stopping = false;
+    std::vector<std::thread> m_workers;
+};
+
+#endif // TAR_ARCHIVER_H
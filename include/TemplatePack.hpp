@@ -0,0 +1,63 @@
+// TemplatePack.hpp
+#ifndef TEMPLATE_PACK_H
+#define TEMPLATE_PACK_H
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// The scaffolding templates dvk generates projects from, named like "make/cpp".
+//
+// The built-in set is the templates/ tree, packed into the binary at build time by
+// tools/packgen.cpp:
+//   "DVKTPK1\n", u32 count,
+//   count x { u32 name offset, u32 name length, u32 data offset, u32 compressed size, u32 size },
+//   names and zlib streams
+// Entries are sorted by name and compressed one by one, so a lookup is a binary search
+// over the index in place and only the templates a command uses are ever inflated.
+// Inflated text is cached for the life of the process.
+//
+// Override directories come first: the first one holding a file with the template's
+// relative path wins. They are listed in $DVK_TEMPLATES (':'-separated), followed by
+// $XDG_CONFIG_HOME/dvk/templates (~/.config/dvk/templates). Each directory is indexed
+// once on first use, and an overriding file is memory-mapped rather than read.
+class TemplatePack {
+public:
+    // Never destroyed, so returned views outlive static destructors.
+    static TemplatePack& instance();
+
+    // Text of the named template; views stay valid until exit.
+    [[nodiscard]] std::optional<std::string_view> find(std::string_view name);
+    // Like find(), but throws std::runtime_error for an unknown name.
+    [[nodiscard]] std::string_view get(std::string_view name);
+    // Every template name, built-in and overridden, sorted.
+    [[nodiscard]] std::vector<std::string> names();
+
+    TemplatePack(const TemplatePack&) = delete;
+    TemplatePack& operator=(const TemplatePack&) = delete;
+
+private:
+    TemplatePack();
+
+    struct Mapping {
+        void* data = nullptr;
+        size_t size = 0;
+    };
+
+    void indexOverrides();
+    [[nodiscard]] std::optional<std::string_view> findBuiltin(std::string_view name);
+
+    std::mutex m_mutex;
+    bool m_indexed = false;
+    std::vector<std::filesystem::path> m_overrideDirs;
+    std::unordered_map<std::string, std::filesystem::path> m_overrides; // Name -> overriding file
+    std::unordered_map<std::string, Mapping> m_mapped;
+    std::unordered_map<std::string, std::string> m_inflated;           // Built-in name -> text
+};
+
+#endif // TEMPLATE_PACK_H
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Asynchronous logging backend, enabled with -DLOG_ASYNC.
+//
+// Each logging thread owns a single-producer ring of preformatted records; a background
+// thread gathers whatever is queued across all rings into a few large writev calls per
+// destination, writing straight out of the rings. Lines from one thread keep their order;
+// lines from different threads interleave at batch granularity. Records are drained at
+// exit (atexit), on print::flush() and before print::prompt(). Output written to stdout
+// by other means (std::cout, fmt::print) should call print::flush() first.
+
+// Bytes of queued records per logging thread (power of two)
+#ifndef LOG_ASYNC_RING_SIZE
+    #define LOG_ASYNC_RING_SIZE (64 * 1024)
+#endif
+
+namespace print {
+
+    // What a producer does when its ring is full
+    enum class Overflow {
+        Block, // Wait for the backend to catch up (default: nothing is lost)
+        Drop   // Discard the record; the number dropped is reported in the log
+    };
+
+namespace detail {
+
+    class LogRing {
+    public:
+        static constexpr size_t kCapacity = LOG_ASYNC_RING_SIZE;
+        static_assert((kCapacity & (kCapacity - 1)) == 0, "LOG_ASYNC_RING_SIZE must be a power of two");
+
+        struct Header {
+            uint32_t size;     // Whole record, padded; 0 marks a wrap to the start of the ring
+            int32_t fd;        // Terminal stream
+            uint32_t term_len;
+            uint32_t file_len; // Or kSameAsTerm / kNoFile
+        };
+        static constexpr uint32_t kSameAsTerm = UINT32_MAX;
+        static constexpr uint32_t kNoFile = UINT32_MAX - 1;
+        static constexpr size_t kAlign = sizeof(Header);
+
+        static constexpr size_t recordSize(const size_t payload) {
+            return (sizeof(Header) + payload + kAlign - 1) & ~(kAlign - 1);
+        }
+        // Larger records bypass the ring
+        static constexpr size_t kMaxRecord = kCapacity / 2;
+
+        // Bytes stored for a record: file is empty (no file line) or aliases term when identical
+        static size_t payloadSize(const std::string_view term, const std::string_view file) {
+            return term.size() + (file.data() == term.data() ? 0 : file.size());
+        }
+
+        // Producer side. False if the record was dropped.
+        bool push(const int fd, const std::string_view term, const std::string_view file, const Overflow policy,
+                  const std::atomic<bool>& stopped) {
+            const bool shared = file.data() == term.data();
+            const size_t need = recordSize(payloadSize(term, file));
+            const uint64_t head = m_head.load(std::memory_order_relaxed);
+            const size_t off = head & (kCapacity - 1);
+            const size_t pad = kCapacity - off < need ? kCapacity - off : 0;
+            while (true) {
+                const uint64_t tail = m_tail.load(std::memory_order_acquire);
+                if (head + pad + need - tail <= kCapacity) break;
+                if (policy == Overflow::Drop || stopped.load(std::memory_order_relaxed)) return false;
+                m_tail.wait(tail, std::memory_order_acquire);
+            }
+
+            if (pad > 0) {
+                constexpr Header wrap{0, -1, 0, 0};
+                std::memcpy(m_data.get() + off, &wrap, sizeof(wrap));
+            }
+            char* out = m_data.get() + ((head + pad) & (kCapacity - 1));
+            const Header header{static_cast<uint32_t>(need), fd, static_cast<uint32_t>(term.size()),
+                                shared ? kSameAsTerm : file.empty() ? kNoFile : static_cast<uint32_t>(file.size())};
+            std::memcpy(out, &header, sizeof(header));
+            std::memcpy(out + sizeof(header), term.data(), term.size());
+            if (!shared) std::memcpy(out + sizeof(header) + term.size(), file.data(), file.size());
+            m_head.store(head + pad + need, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side: appends iovecs for every queued record and returns the position
+        // to release once they have been written.
+        template<typename Sink>
+        uint64_t collect(Sink&& sink) const {
+            const uint64_t head = m_head.load(std::memory_order_acquire);
+            uint64_t pos = m_tail.load(std::memory_order_relaxed);
+            while (pos < head) {
+                const size_t off = pos & (kCapacity - 1);
+                Header header{};
+                std::memcpy(&header, m_data.get() + off, sizeof(header));
+                if (header.size == 0) {
+                    pos += kCapacity - off;
+                    continue;
+                }
+                const char* term = m_data.get() + off + sizeof(header);
+                const std::string_view term_line(term, header.term_len);
+                std::string_view file_line;
+                if (header.file_len == kSameAsTerm) {
+                    file_line = term_line;
+                } else if (header.file_len != kNoFile) {
+                    file_line = std::string_view(term + header.term_len, header.file_len);
+                }
+                sink(header.fd, term_line, file_line);
+                pos += header.size;
+            }
+            return pos;
+        }
+
+        void release(const uint64_t pos) {
+            m_tail.store(pos, std::memory_order_release);
+            m_tail.notify_all();
+        }
+
+        [[nodiscard]] uint64_t head() const { return m_head.load(std::memory_order_acquire); }
+        [[nodiscard]] uint64_t tail() const { return m_tail.load(std::memory_order_acquire); }
+        void waitTail(const uint64_t seen) const { m_tail.wait(seen, std::memory_order_acquire); }
+
+        std::atomic<bool> closed{false}; // Owning thread has exited
+
+    private:
+        std::unique_ptr<char[]> m_data{new char[kCapacity]};
+        alignas(64) std::atomic<uint64_t> m_head{0};
+        alignas(64) std::atomic<uint64_t> m_tail{0};
+    };
+
+    class AsyncLog {
+    public:
+        // Never destroyed: threads may still log while static destructors run. The writer
+        // is stopped (and everything queued written) by an atexit handler instead.
+        static AsyncLog& instance() {
+            static AsyncLog* log = [] {
+                auto* created = new AsyncLog();
+                std::atexit([] { instance().stop(); });
+                return created;
+            }();
+            return *log;
+        }
+
+        // Queues a line for the terminal stream fd. file is the line for the log file: empty
+        // when none is open (see wantsFile), or term itself when the two are identical.
+        void submit(const int fd, const std::string_view term, const std::string_view file) {
+            if (m_stopped.load(std::memory_order_acquire) ||
+                LogRing::recordSize(LogRing::payloadSize(term, file)) > LogRing::kMaxRecord) {
+                flush();
+                writeDirect(fd, term, file);
+                return;
+            }
+            if (!ring().push(fd, term, file, m_policy.load(std::memory_order_relaxed), m_stopped)) {
+                if (m_stopped.load(std::memory_order_acquire)) {
+                    writeDirect(fd, term, file);
+                    return;
+                }
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            wake();
+        }
+
+        // Returns once everything queued before the call has been written.
+        void flush() {
+            std::vector<std::pair<std::shared_ptr<LogRing>, uint64_t>> targets;
+            {
+                std::lock_guard lock(m_ringsMutex);
+                for (const auto& ring : m_rings) targets.emplace_back(ring, ring->head());
+            }
+            wake();
+            for (const auto& [ring, head] : targets) {
+                for (uint64_t tail = ring->tail(); tail < head && !m_stopped.load(); tail = ring->tail()) {
+                    ring->waitTail(tail);
+                }
+            }
+        }
+
+        [[nodiscard]] bool wantsFile() const { return m_fileFd.load(std::memory_order_relaxed) >= 0; }
+
+        void setPolicy(const Overflow policy) { m_policy.store(policy, std::memory_order_relaxed); }
+        [[nodiscard]] uint64_t dropped() const { return m_droppedTotal.load(std::memory_order_relaxed); }
+
+        // Sends plain (uncoloured) copies of every line to path, appending. False if it cannot be opened.
+        bool openFile(const char* path) {
+            const int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (fd < 0) return false;
+            flush();
+            const int old = m_fileFd.exchange(fd);
+            if (old >= 0) close(old);
+            return true;
+        }
+
+    private:
+        AsyncLog() : m_thread([this] { writerLoop(); }) {}
+
+        LogRing& ring() {
+            struct Handle {
+                std::shared_ptr<LogRing> ring;
+                ~Handle() { if (ring) ring->closed.store(true, std::memory_order_release); }
+            };
+            thread_local Handle handle;
+            if (!handle.ring) {
+                handle.ring = std::make_shared<LogRing>();
+                std::lock_guard lock(m_ringsMutex);
+                m_rings.push_back(handle.ring);
+            }
+            return *handle.ring;
+        }
+
+        void wake() {
+            m_pending.fetch_add(1, std::memory_order_release);
+            m_pending.notify_one();
+        }
+
+        void stop() {
+            m_stopping.store(true);
+            wake();
+            if (m_thread.joinable()) m_thread.join();
+            m_stopped.store(true, std::memory_order_release);
+            drain(); // Anything queued while the writer was finishing
+            // Release producers blocked on a full ring; they fall back to direct writes
+            std::lock_guard lock(m_ringsMutex);
+            for (const auto& ring : m_rings) ring->release(ring->tail());
+        }
+
+        void writerLoop() {
+            while (true) {
+                const uint32_t seen = m_pending.load(std::memory_order_acquire);
+                const bool stopping = m_stopping.load();
+                if (drain() == 0) {
+                    if (stopping) break;
+                    m_pending.wait(seen, std::memory_order_acquire);
+                }
+            }
+        }
+
+        // One pass over every ring. Returns the number of records written.
+        size_t drain() {
+            {
+                std::lock_guard lock(m_ringsMutex);
+                m_snapshot.assign(m_rings.begin(), m_rings.end());
+            }
+            const int file_fd = m_fileFd.load(std::memory_order_acquire);
+            size_t records = 0;
+            m_release.clear();
+            for (auto& batch : m_batches) batch.second.clear();
+            for (const auto& ring : m_snapshot) {
+                m_release.push_back(ring->collect([&](const int fd, const std::string_view term, const std::string_view file) {
+                    batchFor(fd).push_back({const_cast<char*>(term.data()), term.size()});
+                    if (file_fd >= 0 && !file.empty()) batchFor(file_fd).push_back({const_cast<char*>(file.data()), file.size()});
+                    ++records;
+                }));
+            }
+
+            std::string notice;
+            if (const uint64_t dropped = m_dropped.exchange(0, std::memory_order_relaxed); dropped > 0) {
+                m_droppedTotal.fetch_add(dropped, std::memory_order_relaxed);
+                notice = "[log] dropped " + std::to_string(dropped) + " messages: logging outpaced output\n";
+                batchFor(STDERR_FILENO).push_back({notice.data(), notice.size()});
+            }
+            for (auto& [fd, iov] : m_batches) writeAll(fd, iov);
+
+            for (size_t i = 0; i < m_snapshot.size(); ++i) {
+                if (m_release[i] != m_snapshot[i]->tail()) m_snapshot[i]->release(m_release[i]);
+            }
+            // Forget rings whose thread has exited and whose records have all been written
+            std::lock_guard lock(m_ringsMutex);
+            std::erase_if(m_rings, [](const std::shared_ptr<LogRing>& ring) {
+                return ring->closed.load(std::memory_order_acquire) && ring->tail() == ring->head();
+            });
+            return records;
+        }
+
+        std::vector<iovec>& batchFor(const int fd) {
+            for (auto& [batch_fd, iov] : m_batches) {
+                if (batch_fd == fd) return iov;
+            }
+            return m_batches.emplace_back(fd, std::vector<iovec>{}).second;
+        }
+
+        static void writeAll(const int fd, std::vector<iovec>& iov) {
+            size_t first = 0;
+            while (first < iov.size()) {
+                const int count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+                const ssize_t written = writev(fd, iov.data() + first, count);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    return; // Nowhere left to report it
+                }
+                // Skip fully written buffers and trim a partially written one
+                auto left = static_cast<size_t>(written);
+                while (first < iov.size() && left >= iov[first].iov_len) left -= iov[first++].iov_len;
+                if (left > 0) {
+                    iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + left;
+                    iov[first].iov_len -= left;
+                }
+            }
+        }
+
+        void writeDirect(const int fd, const std::string_view term, const std::string_view file) const {
+            std::lock_guard lock(m_directMutex);
+            std::vector<iovec> iov{{const_cast<char*>(term.data()), term.size()}};
+            writeAll(fd, iov);
+            if (const int file_fd = m_fileFd.load(); file_fd >= 0 && !file.empty()) {
+                iov = {{const_cast<char*>(file.data()), file.size()}};
+                writeAll(file_fd, iov);
+            }
+        }
+
+        std::atomic<Overflow> m_policy{Overflow::Block};
+        std::atomic<uint32_t> m_pending{0};
+        std::atomic<bool> m_stopped{false};
+        std::atomic<bool> m_stopping{false};
+        std::atomic<uint64_t> m_dropped{0};      // Since the last notice
+        std::atomic<uint64_t> m_droppedTotal{0};
+        std::atomic<int> m_fileFd{-1};
+        mutable std::mutex m_directMutex;
+
+        std::mutex m_ringsMutex;
+        std::vector<std::shared_ptr<LogRing>> m_rings;
+
+        // Writer thread only
+        std::vector<std::shared_ptr<LogRing>> m_snapshot;
+        std::vector<uint64_t> m_release;
+        std::vector<std::pair<int, std::vector<iovec>>> m_batches;
+
+        std::thread m_thread; // Last: starts running in the constructor
+    };
+
+} // namespace detail
+
+    inline void set_overflow_policy(const Overflow policy) { detail::AsyncLog::instance().setPolicy(policy); }
+
+    // Total lines discarded under Overflow::Drop.
+    inline uint64_t dropped_messages() { return detail::AsyncLog::instance().dropped(); }
+
+    // Also writes every line, without colours, to path (appending).
+    inline bool open_log_file(const char* path) { return detail::AsyncLog::instance().openFile(path); }
+
+} // namespace print
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <fmt/core.h>
+
+// Structured binary log sink.
+//
+// Instead of formatted text, each record holds the id of its format string, a timestamp,
+// a thread number and the raw argument values, so logging a line costs a few memcpys.
+// Format strings are written to the file once, the first time they are used, which
+// makes the file self-describing: `dvk logdump <file>` turns it back into text.
+//
+// File layout (native byte order):
+//   "DVKBLOG1"
+//   'F' u32 id, u8 level, u32 length, format text      -- before the first event using id
+//   'E' u32 id, u64 unix time ns, u32 thread, u8 argc, argc x (u8 tag, value)
+// Values: Int/UInt/Double are 8 bytes, Bool/Char 1 byte, String u32 length + bytes.
+//
+// Events are buffered per thread and appended to the file in blocks; buffers are
+// written when full, by print::flush(), and when their thread exits.
+
+namespace print::binlog {
+
+    inline constexpr char kMagic[8] = {'D', 'V', 'K', 'B', 'L', 'O', 'G', '1'};
+
+    enum class Tag : uint8_t { Int, UInt, Double, Bool, Char, String };
+
+namespace detail {
+
+    inline constexpr size_t kFlushThreshold = 64 * 1024;
+
+    inline std::atomic<int> g_fd{-1};
+    inline std::mutex g_mutex;                                        // Guards the file and the table
+    inline std::unordered_map<const char*, uint32_t> g_ids;           // Format string address -> id
+    inline std::vector<std::pair<uint8_t, std::string_view>> g_formats; // id -> (level, text)
+    inline std::atomic<uint32_t> g_threads{0};
+
+    inline void writeAll(const int fd, const char* data, size_t size) {
+        while (size > 0) {
+            const ssize_t n = write(fd, data, size);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+    }
+
+    template<typename V>
+    void put(std::string& out, const V value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    inline void putFormat(std::string& out, const uint32_t id, const uint8_t level, const std::string_view text) {
+        out.push_back('F');
+        put(out, id);
+        put(out, level);
+        put(out, static_cast<uint32_t>(text.size()));
+        out.append(text);
+    }
+
+    struct ThreadBuffer {
+        std::string data;
+        uint32_t thread = g_threads.fetch_add(1, std::memory_order_relaxed);
+        std::unordered_map<const char*, uint32_t> ids; // Lock-free lookups after the first use
+
+        void flush() {
+            if (data.empty()) return;
+            std::lock_guard lock(g_mutex);
+            if (const int fd = g_fd.load(); fd >= 0) writeAll(fd, data.data(), data.size());
+            data.clear();
+        }
+        ~ThreadBuffer() { flush(); }
+    };
+
+    inline ThreadBuffer& threadBuffer() {
+        thread_local ThreadBuffer buffer;
+        return buffer;
+    }
+
+    // Id for a format string, keyed by its address: call sites pass string literals.
+    // A new format is written to the file straight away, so its definition always
+    // precedes any buffered event that refers to it.
+    inline uint32_t intern(ThreadBuffer& buffer, const std::string_view format, const uint8_t level) {
+        if (const auto it = buffer.ids.find(format.data()); it != buffer.ids.end()) return it->second;
+        std::lock_guard lock(g_mutex);
+        auto [it, inserted] = g_ids.try_emplace(format.data(), static_cast<uint32_t>(g_formats.size()));
+        if (inserted) {
+            g_formats.emplace_back(level, format);
+            if (const int fd = g_fd.load(); fd >= 0) {
+                std::string definition;
+                putFormat(definition, it->second, level, format);
+                writeAll(fd, definition.data(), definition.size());
+            }
+        }
+        buffer.ids.emplace(format.data(), it->second);
+        return it->second;
+    }
+
+    template<typename A>
+    void putArg(std::string& out, const A& arg) {
+        using D = std::decay_t<A>;
+        auto putString = [&out](const std::string_view s) {
+            out.push_back(static_cast<char>(Tag::String));
+            put(out, static_cast<uint32_t>(s.size()));
+            out.append(s);
+        };
+        if constexpr (std::is_same_v<D, bool>) {
+            out.push_back(static_cast<char>(Tag::Bool));
+            out.push_back(static_cast<char>(arg));
+        } else if constexpr (std::is_same_v<D, char>) {
+            out.push_back(static_cast<char>(Tag::Char));
+            out.push_back(arg);
+        } else if constexpr (std::is_integral_v<D> && std::is_signed_v<D>) {
+            out.push_back(static_cast<char>(Tag::Int));
+            put(out, static_cast<int64_t>(arg));
+        } else if constexpr (std::is_integral_v<D>) {
+            out.push_back(static_cast<char>(Tag::UInt));
+            put(out, static_cast<uint64_t>(arg));
+        } else if constexpr (std::is_floating_point_v<D>) {
+            out.push_back(static_cast<char>(Tag::Double));
+            put(out, static_cast<double>(arg));
+        } else if constexpr (std::is_convertible_v<const D&, std::string_view>) {
+            putString(std::string_view(arg));
+        } else {
+            putString(fmt::format("{}", arg)); // Anything else is stored as its text
+        }
+    }
+
+} // namespace detail
+
+    [[nodiscard]] inline bool active() { return detail::g_fd.load(std::memory_order_relaxed) >= 0; }
+
+    // Starts (or restarts) binary logging to path, truncating it. False if it cannot be opened.
+    inline bool open(const char* path) {
+        const int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+        detail::threadBuffer().flush();
+        std::lock_guard lock(detail::g_mutex);
+        std::string header(kMagic, sizeof(kMagic));
+        for (uint32_t id = 0; id < detail::g_formats.size(); ++id) {
+            detail::putFormat(header, id, detail::g_formats[id].first, detail::g_formats[id].second);
+        }
+        detail::writeAll(fd, header.data(), header.size());
+        if (const int old = detail::g_fd.exchange(fd); old >= 0) close(old);
+        return true;
+    }
+
+    // Writes the calling thread's buffered events.
+    inline void flush() { detail::threadBuffer().flush(); }
+
+    template<typename... T>
+    void record(const uint8_t level, const std::string_view format, const T&... args) {
+        static_assert(sizeof...(T) < 256, "too many log arguments");
+        auto& buffer = detail::threadBuffer();
+        const uint32_t id = detail::intern(buffer, format, level);
+        timespec now{};
+        clock_gettime(CLOCK_REALTIME_COARSE, &now);
+        std::string& out = buffer.data;
+        out.push_back('E');
+        detail::put(out, id);
+        detail::put(out, static_cast<uint64_t>(now.tv_sec) * 1000000000u + static_cast<uint64_t>(now.tv_nsec));
+        detail::put(out, buffer.thread);
+        detail::put(out, static_cast<uint8_t>(sizeof...(T)));
+        (detail::putArg(out, args), ...);
+        if (out.size() >= detail::kFlushThreshold) buffer.flush();
+    }
+
+    // Prints every record of a binary log as text lines. False if path is not a binary log.
+    bool decode(const std::string& path, FILE* out);
+
+} // namespace print::binlog
@@ -0,0 +1,463 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "profile.hpp"
+#include "uring.hpp"
+
+// Copying many files at once, shared by dvk install and dvk clone.
+//
+// copy_files() copies each file into a newly created destination with the requested mode
+// and, optionally, timestamps, using the cheapest strategy the two filesystems allow:
+//
+//   reflink          FICLONE shares the source's extents (btrfs, XFS, bcachefs): no data
+//                    is copied and no space used.
+//   io_uring         Small files become one linked openat -> openat -> read -> write chain
+//                    on two direct descriptors, a whole wave of them per io_uring_enter; a
+//                    second, unlinked submission closes the descriptors. io_uring has no
+//                    copy_file_range or fchmod, so the data passes through a per-thread
+//                    buffer and modes the umask would change are fixed with fchmodat.
+//   copy_file_range  Large files, and every file on kernels without io_uring direct
+//                    descriptors (before 5.15), stay in the kernel one file at a time.
+//   read/write       sendfile or a userspace loop when copy_file_range can't be used.
+//
+// What a pair of devices supports is probed with the first file copied between them and
+// remembered for the rest of the process. Batches can be spread over worker threads.
+
+namespace bulkcopy {
+
+    // How a file's data was copied, cheapest first
+    enum class Strategy : uint8_t { Reflink, Ring, CopyRange, ReadWrite };
+    inline constexpr size_t kStrategies = 4;
+
+    inline const char* strategy_name(const Strategy strategy) {
+        static constexpr const char* names[kStrategies] = {"reflink", "io_uring", "copy_file_range", "read/write"};
+        return names[static_cast<size_t>(strategy)];
+    }
+
+} // namespace bulkcopy
+
+struct FileCopy {
+    int src_dir;                     // Directory descriptors, or AT_FDCWD
+    const char* src;                 // Relative to src_dir
+    int dst_dir;
+    const char* dst;                 // Relative to dst_dir; must not exist yet
+    uint64_t size;                   // From stat; this many bytes are copied
+    mode_t mode = 0644;              // Permission bits of the copy
+    const timespec* times = nullptr; // atime and mtime for the copy, or null to leave them
+    int error = 0;                   // errno for this file once copied, 0 on success
+    bulkcopy::Strategy strategy = bulkcopy::Strategy::ReadWrite; // How it was copied
+};
+
+namespace bulkcopy {
+
+    // Copies size bytes between two descriptors, keeping the data in the kernel where possible.
+    // strategy is CopyRange to try copy_file_range first or ReadWrite to skip it, and ends
+    // up ReadWrite if copy_file_range couldn't be used for this pair of files.
+    inline bool copy_data(const int in_fd, const int out_fd, off_t size, Strategy& strategy) {
+        bool use_copy_range = strategy == Strategy::CopyRange;
+        bool use_sendfile = true;
+        uint64_t syscalls = 0;
+        const off_t requested = size;
+        const auto finish = [&](const bool ok) {
+            profile::count(profile::Phase::Copy, syscalls, static_cast<uint64_t>(requested - size));
+            return ok;
+        };
+        while (size > 0) {
+            ssize_t n = -1;
+            ++syscalls;
+            if (use_copy_range) {
+                n = copy_file_range(in_fd, nullptr, out_fd, nullptr, static_cast<size_t>(size), 0);
+                if (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                    use_copy_range = false;
+                    strategy = Strategy::ReadWrite;
+                    continue;
+                }
+            } else if (use_sendfile) {
+                n = sendfile(out_fd, in_fd, nullptr, static_cast<size_t>(size));
+                if (n < 0 && (errno == ENOSYS || errno == EINVAL)) {
+                    use_sendfile = false;
+                    continue;
+                }
+            } else {
+                char buf[64 * 1024];
+                n = read(in_fd, buf, sizeof(buf));
+                for (ssize_t done = 0; n > 0 && done < n;) {
+                    ++syscalls;
+                    const ssize_t w = write(out_fd, buf + done, static_cast<size_t>(n - done));
+                    if (w < 0) {
+                        if (errno == EINTR) continue;
+                        return finish(false);
+                    }
+                    done += w;
+                }
+            }
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return finish(false);
+            }
+            if (n == 0) {
+                // Some filesystems (procfs, sysfs, some FUSE) report no data to the in-kernel
+                // copies of a file stat calls non-empty: fall back to reading it
+                if (size == requested && use_copy_range) {
+                    use_copy_range = false;
+                    strategy = Strategy::ReadWrite;
+                    continue;
+                }
+                if (size == requested && use_sendfile) {
+                    use_sendfile = false;
+                    continue;
+                }
+                break; // File shrank while copying
+            }
+            size -= n;
+        }
+        return finish(true);
+    }
+
+} // namespace bulkcopy
+
+namespace bulkcopy::detail {
+
+    // Files per submission; each uses four SQEs and two direct descriptor slots
+    inline constexpr unsigned kWave = 32;
+    // Larger files skip the ring: copy_file_range moves them without a userspace copy
+    inline constexpr uint64_t kRingMaxFile = 128 * 1024;
+    // Per-thread staging buffer a wave's data passes through
+    inline constexpr size_t kWaveBytes = 1024 * 1024;
+
+    // The process umask, read without changing it (umask(2) would race other threads
+    // creating files). All bits set when unknown, so every mode gets an explicit fchmodat.
+    inline mode_t processUmask() {
+        static const mode_t mask = [] {
+            mode_t value = 07777;
+            if (FILE* status = std::fopen("/proc/self/status", "re")) {
+                char line[128];
+                unsigned parsed = 0;
+                while (std::fgets(line, sizeof(line), status)) {
+                    if (std::sscanf(line, "Umask: %o", &parsed) == 1) {
+                        value = static_cast<mode_t>(parsed);
+                        break;
+                    }
+                }
+                std::fclose(status);
+            }
+            return value;
+        }();
+        return mask;
+    }
+
+    // What copying from one device to another supports; -1 while unknown
+    struct DeviceCaps {
+        dev_t src = 0;
+        dev_t dst = 0;
+        int8_t reflink = -1;
+        int8_t copy_range = -1;
+    };
+
+    // Learned once per device pair and shared by every thread and batch
+    inline std::mutex g_capsMutex;
+    inline std::vector<DeviceCaps> g_caps;
+
+    inline DeviceCaps deviceCaps(const dev_t src, const dev_t dst) {
+        std::lock_guard lock(g_capsMutex);
+        for (const auto& caps : g_caps) {
+            if (caps.src == src && caps.dst == dst) return caps;
+        }
+        return g_caps.emplace_back(DeviceCaps{src, dst});
+    }
+
+    inline void learn(const DeviceCaps& learned) {
+        std::lock_guard lock(g_capsMutex);
+        for (auto& caps : g_caps) {
+            if (caps.src != learned.src || caps.dst != learned.dst) continue;
+            if (caps.reflink < 0) caps.reflink = learned.reflink;
+            if (caps.copy_range < 0) caps.copy_range = learned.copy_range;
+        }
+    }
+
+    inline dev_t dirDevice(const int dir_fd) {
+        struct stat st{};
+        profile::count(profile::Phase::Copy, 1);
+        return fstatat(dir_fd, ".", &st, 0) == 0 ? st.st_dev : 0;
+    }
+
+    // Copies one file with plain syscalls, by reflink when caps doesn't rule it out and
+    // otherwise through copy_data; returns 0 or errno. The first copy between two devices
+    // settles what caps didn't know yet.
+    inline int copySync(FileCopy& f, const int flags, DeviceCaps& caps) {
+        const int in = openat(f.src_dir, f.src, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        if (in < 0) return errno;
+        const int out = openat(f.dst_dir, f.dst, O_WRONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC | flags, S_IRUSR | S_IWUSR);
+        if (out < 0) {
+            const int err = errno;
+            close(in);
+            return err;
+        }
+        const DeviceCaps known = caps;
+        bool copied = false;
+        if (caps.reflink != 0) {
+            profile::count(profile::Phase::Copy, 1);
+            if (ioctl(out, FICLONE, in) == 0) {
+                copied = true;
+                caps.reflink = 1;
+                f.strategy = Strategy::Reflink;
+            } else if (caps.reflink < 0 && (errno == EOPNOTSUPP || errno == EXDEV || errno == EINVAL || errno == ENOTTY)) {
+                caps.reflink = 0;
+            }
+        }
+        int err = 0;
+        if (!copied) {
+            f.strategy = caps.copy_range == 0 ? Strategy::ReadWrite : Strategy::CopyRange;
+            if (!copy_data(in, out, static_cast<off_t>(f.size), f.strategy)) err = errno ? errno : EIO;
+            else if (caps.copy_range < 0 && f.size) caps.copy_range = f.strategy == Strategy::CopyRange;
+        }
+        if (!err && (fchmod(out, f.mode) != 0 || (f.times && futimens(out, f.times) != 0))) err = errno;
+        close(in);
+        if (close(out) != 0 && !err) err = errno;
+        if (err) unlinkat(f.dst_dir, f.dst, 0); // Ours either way: created here or by a ring chain
+        profile::count(profile::Phase::Copy, f.times ? 6 : 5); // open (x2), fchmod, futimens, close (x2)
+        if (caps.reflink != known.reflink || caps.copy_range != known.copy_range) learn(caps);
+        return err;
+    }
+
+    enum Step : uint64_t { OpenSrc, OpenDst, Read, Write, CloseSrc, CloseDst };
+
+    // What the plain-syscall pass still has to do for a file. Created: the ring made the
+    // destination but its data didn't arrive, so it is removed if the file failed.
+    enum State : uint8_t { Create, Created, Copied, Redo, Done };
+
+    // Completes a submission of expected SQEs, passing every completion to on_cqe.
+    template<typename F>
+    bool drain(Uring& ring, const unsigned expected, F&& on_cqe) {
+        if (ring.submit(expected) < 0) return false;
+        profile::count(profile::Phase::Copy, 1);
+        unsigned seen = 0;
+        while (true) {
+            seen += ring.reap(on_cqe);
+            if (seen >= expected) return true;
+            if (ring.submit(1) < 0) return false;
+        }
+    }
+
+    // Copies the files listed in wave through the ring, staging their data in buf.
+    // Returns false if the kernel rejected direct descriptors; those files are left to Redo.
+    inline bool copyWave(Uring& ring, std::span<FileCopy> files, const std::vector<uint32_t>& wave, char* buf,
+                         std::vector<uint8_t>& state) {
+        unsigned expected = 0;
+        size_t offset = 0;
+        for (size_t k = 0; k < wave.size(); ++k) {
+            const uint32_t i = wave[k];
+            const FileCopy& f = files[i];
+            const auto src_slot = static_cast<unsigned>(2 * k);
+            const uint64_t tag = static_cast<uint64_t>(i) << 3;
+
+            io_uring_sqe* open_src = ring.next();
+            open_src->opcode = IORING_OP_OPENAT;
+            open_src->fd = f.src_dir;
+            open_src->addr = reinterpret_cast<uint64_t>(f.src);
+            open_src->open_flags = O_RDONLY | O_NOFOLLOW; // No O_CLOEXEC: direct descriptors are never exec'd
+            open_src->file_index = src_slot + 1;
+            open_src->flags = IOSQE_IO_LINK;
+            open_src->user_data = tag | OpenSrc;
+
+            io_uring_sqe* open_dst = ring.next();
+            open_dst->opcode = IORING_OP_OPENAT;
+            open_dst->fd = f.dst_dir;
+            open_dst->addr = reinterpret_cast<uint64_t>(f.dst);
+            open_dst->len = f.mode;
+            open_dst->open_flags = O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW;
+            open_dst->file_index = src_slot + 2;
+            open_dst->flags = f.size ? IOSQE_IO_LINK : 0;
+            open_dst->user_data = tag | OpenDst;
+            expected += 2;
+            if (!f.size) continue;
+
+            // A short read (the file shrank) breaks the link, so nothing stale is written
+            io_uring_sqe* read = ring.next();
+            read->opcode = IORING_OP_READ;
+            read->fd = static_cast<int>(src_slot);
+            read->addr = reinterpret_cast<uint64_t>(buf + offset);
+            read->len = static_cast<uint32_t>(f.size);
+            read->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+            read->user_data = tag | Read;
+
+            io_uring_sqe* write = ring.next();
+            write->opcode = IORING_OP_WRITE;
+            write->fd = static_cast<int>(src_slot + 1);
+            write->addr = reinterpret_cast<uint64_t>(buf + offset);
+            write->len = static_cast<uint32_t>(f.size);
+            write->flags = IOSQE_FIXED_FILE;
+            write->user_data = tag | Write;
+            expected += 2;
+            offset += f.size;
+        }
+
+        bool unsupported = false;
+        const bool submitted = drain(ring, expected, [&](const uint64_t user_data, const int res) {
+            const size_t i = user_data >> 3;
+            FileCopy& f = files[i];
+            switch (user_data & 7) {
+                case OpenSrc:
+                case OpenDst:
+                    if (res == -EINVAL || res == -EOPNOTSUPP) {
+                        unsupported = true;
+                        state[i] = Redo;
+                    } else if (res < 0 && res != -ECANCELED) {
+                        f.error = -res;
+                    } else if (res >= 0 && (user_data & 7) == OpenDst) {
+                        state[i] = f.size ? Created : Copied;
+                    }
+                    break;
+                case Read:
+                    if (res >= 0 && static_cast<uint64_t>(res) != f.size) state[i] = Redo;
+                    else if (res < 0 && res != -ECANCELED && !f.error) f.error = -res;
+                    break;
+                default:
+                    if (res >= 0 && static_cast<uint64_t>(res) == f.size) state[i] = Copied;
+                    else if (res >= 0) state[i] = Redo; // Short write: finish with plain syscalls
+                    else if (res != -ECANCELED && !f.error) f.error = -res;
+                    break;
+            }
+        });
+        if (!submitted) {
+            for (const uint32_t i : wave) state[i] = Redo;
+            return false;
+        }
+
+        // Close every slot, whatever happened to its chain; slots never opened report EBADF
+        for (size_t k = 0; k < wave.size(); ++k) {
+            const uint64_t tag = static_cast<uint64_t>(wave[k]) << 3;
+            for (unsigned side = 0; side < 2; ++side) {
+                io_uring_sqe* close = ring.next();
+                close->opcode = IORING_OP_CLOSE;
+                close->file_index = static_cast<unsigned>(2 * k) + side + 1;
+                close->user_data = tag | (side ? CloseDst : CloseSrc);
+            }
+        }
+        drain(ring, static_cast<unsigned>(wave.size()) * 2, [&](const uint64_t user_data, const int res) {
+            const size_t i = user_data >> 3;
+            if ((user_data & 7) == CloseDst && res < 0 && res != -EBADF && state[i] == Copied) {
+                files[i].error = -res;
+            }
+        });
+        return !unsupported;
+    }
+
+    // Copies files on the calling thread.
+    inline void copyRange(std::span<FileCopy> files) {
+        std::vector<uint8_t> state(files.size(), Create);
+        std::vector<uint32_t> wave;
+
+        // Every (source dir, destination dir) pair in the batch, with what its devices support
+        struct DirPair {
+            int src_dir;
+            int dst_dir;
+            DeviceCaps caps;
+        };
+        std::vector<DirPair> pairs;
+        std::vector<uint32_t> pair_of(files.size());
+        for (size_t i = 0, last = 0; i < files.size(); ++i) {
+            const FileCopy& f = files[i];
+            if (last >= pairs.size() || pairs[last].src_dir != f.src_dir || pairs[last].dst_dir != f.dst_dir) {
+                last = 0;
+                while (last < pairs.size() && (pairs[last].src_dir != f.src_dir || pairs[last].dst_dir != f.dst_dir)) ++last;
+                if (last == pairs.size()) {
+                    pairs.push_back({f.src_dir, f.dst_dir, deviceCaps(dirDevice(f.src_dir), dirDevice(f.dst_dir))});
+                    // An unprobed pair copies its first file right away; that settles reflink
+                    if (pairs.back().caps.reflink < 0) {
+                        files[i].error = copySync(files[i], O_EXCL, pairs.back().caps);
+                        state[i] = Done;
+                    }
+                }
+            }
+            pair_of[i] = static_cast<uint32_t>(last);
+        }
+
+        thread_local std::unique_ptr<char[]> buf;
+        Uring* ring = files.size() > 1 ? Uring::forThread(kWave * 4, kWave * 2) : nullptr;
+        if (ring && !buf) buf.reset(new char[kWaveBytes]);
+
+        size_t wave_bytes = 0;
+        const auto flush = [&] {
+            if (wave.empty()) return;
+            if (!copyWave(*ring, files, wave, buf.get(), state)) {
+                Uring::disableForThread();
+                ring = nullptr;
+            }
+            wave.clear();
+            wave_bytes = 0;
+        };
+        for (size_t i = 0; ring && i < files.size(); ++i) {
+            // Reflinks are cheaper than any copy, however small the file
+            if (state[i] == Done || files[i].size > kRingMaxFile || pairs[pair_of[i]].caps.reflink > 0) continue;
+            if (wave.size() == kWave || wave_bytes + files[i].size > kWaveBytes) flush();
+            if (!ring) break;
+            wave.push_back(static_cast<uint32_t>(i));
+            wave_bytes += files[i].size;
+        }
+        if (ring) flush();
+
+        const mode_t mask = processUmask();
+        for (size_t i = 0; i < files.size(); ++i) {
+            FileCopy& f = files[i];
+            if (f.error) {
+                // Don't leave an empty or partial copy behind a failed chain
+                if (state[i] == Created || state[i] == Copied) unlinkat(f.dst_dir, f.dst, 0);
+                continue;
+            }
+            if (state[i] == Done) continue;
+            if (state[i] != Copied) {
+                // A redone file may already have been created by its chain
+                f.error = copySync(f, state[i] == Redo ? O_TRUNC : O_EXCL, pairs[pair_of[i]].caps);
+                continue;
+            }
+            f.strategy = bulkcopy::Strategy::Ring;
+            // The ring created the file with f.mode; only what the umask removed needs fixing
+            if ((f.mode & mask) && fchmodat(f.dst_dir, f.dst, f.mode, 0) != 0) f.error = errno;
+            else if (f.times && utimensat(f.dst_dir, f.dst, f.times, AT_SYMLINK_NOFOLLOW) != 0) f.error = errno;
+            profile::count(profile::Phase::Copy, ((f.mode & mask) ? 1 : 0) + (f.times ? 1 : 0), f.size);
+        }
+    }
+
+} // namespace bulkcopy::detail
+
+// Copies every file, spread over up to threads threads; sets each FileCopy::error and
+// returns how many failed. Destinations' parent directories must already exist.
+inline size_t copy_files(std::vector<FileCopy>& files, unsigned threads = 1) {
+    using namespace bulkcopy::detail;
+    // Callers time the copy phase themselves; this only marks the batch in traces
+    const profile::ScopedTimer timer(profile::Phase::None, "copy_files");
+    // A thread's share should at least fill a few waves
+    threads = static_cast<unsigned>(std::clamp<size_t>(files.size() / (kWave * 4), 1, std::max(1u, threads)));
+    const std::span<FileCopy> all(files);
+    if (threads == 1) {
+        copyRange(all);
+    } else {
+        const size_t chunk = (files.size() + threads - 1) / threads;
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for (unsigned t = 1; t < threads; ++t) {
+            const size_t begin = std::min(files.size(), t * chunk);
+            workers.emplace_back([all, begin, chunk] { copyRange(all.subspan(begin, std::min(chunk, all.size() - begin))); });
+        }
+        copyRange(all.first(std::min(chunk, files.size())));
+        for (auto& worker : workers) worker.join();
+    }
+
+    return static_cast<size_t>(std::ranges::count_if(files, [](const FileCopy& f) { return f.error != 0; }));
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Finds commands the way execvp would, from a table of the executables in each PATH
+// directory, like a shell's `hash`. PATH is split once (again only if it changes) and each
+// directory is listed with getdents64 the first time it is searched. After that a lookup
+// costs one stat of each directory searched, to notice a changed mtime, plus a stat and an
+// access() of the hit; a directory whose mtime moved is listed again.
+//
+// Shared by the process launcher and the installer; safe to use from several threads.
+class CommandResolver {
+public:
+    enum class Search {
+        Exec,    // Exactly what execvp searches: an empty entry is ".", an unset PATH the default list
+        Trusted, // Only non-empty entries without "..", and nothing when PATH is unset
+    };
+
+    // Never destroyed, so it can be used from static destructors and exiting threads.
+    static CommandResolver& instance() {
+        static auto* resolver = new CommandResolver;
+        return *resolver;
+    }
+
+    // Path that exec would run for name, or "" if there is none. Names containing '/' are
+    // not looked up in PATH and come back unchanged.
+    [[nodiscard]] std::string resolve(const std::string_view name, const Search search = Search::Exec) {
+        if (name.empty() || name.find('/') != std::string_view::npos) return std::string(name);
+        std::lock_guard lock(m_mutex);
+        syncPath();
+        if (search == Search::Trusted && m_unset) return "";
+        for (Directory& dir : m_dirs) {
+            if (search == Search::Trusted && !dir.trusted) continue;
+            refresh(dir);
+            if (!dir.names.contains(name)) continue;
+            std::string candidate = dir.path;
+            candidate.append(1, '/').append(name);
+            if (isExecutable(candidate.c_str())) return candidate;
+        }
+        return "";
+    }
+
+    // Whether command, a path or a name to look up in the trusted part of PATH, is an
+    // executable regular file.
+    [[nodiscard]] bool executable(const std::string_view command) {
+        if (command.empty()) return false;
+        if (command.find('/') != std::string_view::npos) return isExecutable(std::string(command).c_str());
+        return !resolve(command, Search::Trusted).empty();
+    }
+
+    CommandResolver(const CommandResolver&) = delete;
+    CommandResolver& operator=(const CommandResolver&) = delete;
+
+private:
+    CommandResolver() = default;
+
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(const std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    struct Directory {
+        std::string path;
+        bool trusted = false; // Searched by Search::Trusted
+        bool scanned = false;
+        dev_t dev = 0;
+        ino_t ino = 0;
+        timespec mtime{};
+        std::unordered_set<std::string, NameHash, std::equal_to<>> names; // Entries that may be executables
+    };
+
+    static bool isExecutable(const char* path) {
+        struct stat st{};
+        return stat(path, &st) == 0 && S_ISREG(st.st_mode) && access(path, X_OK) == 0;
+    }
+
+    // Re-splits PATH when it differs from the copy the table was built from
+    void syncPath() {
+        const char* env = std::getenv("PATH");
+        const std::string_view path = env ? env : "/usr/local/bin:/usr/bin:/bin";
+        if (!m_dirs.empty() && path == m_path && m_unset == !env) return;
+        m_path = path;
+        m_unset = !env;
+        m_dirs.clear();
+        for (size_t begin = 0; begin <= path.size();) {
+            size_t end = path.find(':', begin);
+            if (end == std::string_view::npos) end = path.size();
+            Directory& dir = m_dirs.emplace_back();
+            // An empty entry is the current directory, as for execvp
+            dir.path = begin == end ? "." : std::string(path.substr(begin, end - begin));
+            dir.trusted = begin != end && dir.path.find("..") == std::string::npos && dir.path.size() < PATH_MAX;
+            begin = end + 1;
+        }
+    }
+
+    void refresh(Directory& dir) {
+        struct stat st{};
+        if (stat(dir.path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+            dir.scanned = false;
+            dir.names.clear();
+            return;
+        }
+        if (dir.scanned && st.st_dev == dir.dev && st.st_ino == dir.ino && st.st_mtim.tv_sec == dir.mtime.tv_sec &&
+            st.st_mtim.tv_nsec == dir.mtime.tv_nsec) {
+            return;
+        }
+        scan(dir);
+        dir.dev = st.st_dev;
+        dir.ino = st.st_ino;
+        dir.mtime = st.st_mtim;
+        // A change in the same timestamp tick as the listing would go unnoticed, so a
+        // directory modified in the last two seconds is listed again next time
+        timespec now{};
+        clock_gettime(CLOCK_REALTIME_COARSE, &now);
+        if (now.tv_sec - st.st_mtim.tv_sec < 2) dir.scanned = false;
+    }
+
+    void scan(Directory& dir) {
+        dir.names.clear();
+        dir.scanned = true;
+        const int fd = open(dir.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) return;
+        static constexpr size_t kBufferSize = 32 * 1024;
+        const auto buffer = std::make_unique<char[]>(kBufferSize);
+        ssize_t n;
+        while ((n = getdents64(fd, buffer.get(), kBufferSize)) > 0) {
+            for (ssize_t off = 0; off < n;) {
+                const auto* d = reinterpret_cast<const dirent64*>(buffer.get() + off);
+                off += d->d_reclen;
+                // Directories, devices and sockets can't be run; symlinks are checked on a hit
+                if (d->d_type != DT_REG && d->d_type != DT_LNK && d->d_type != DT_UNKNOWN) continue;
+                if (d->d_name[0] == '.' && (d->d_name[1] == '\0' || (d->d_name[1] == '.' && d->d_name[2] == '\0'))) continue;
+                dir.names.emplace(d->d_name);
+            }
+        }
+        close(fd);
+    }
+
+    std::mutex m_mutex;
+    std::string m_path; // The PATH m_dirs was split from
+    bool m_unset = false; // m_path is the default, PATH itself is unset
+    std::vector<Directory> m_dirs;
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// A C tokenizer for tools that rewrite source text: it finds identifiers and steps over
+// comments, string and character literals (including prefixed and raw strings) and
+// numbers, and marks which tokens belong to a preprocessor directive. Whitespace is
+// never a token: the text between two tokens is always whitespace or line splices, so
+// concatenating tokens and the gaps between them reproduces the input exactly.
+
+namespace ctok {
+
+    enum class Kind : uint8_t { Identifier, Number, String, Comment, Punct };
+
+    struct Token {
+        Kind kind;
+        bool directive; // Part of a #-line, continuation lines included
+        bool first;     // First token of its logical line
+        size_t begin;   // Byte offsets into the source
+        size_t end;
+
+        [[nodiscard]] std::string_view text(const std::string_view src) const { return src.substr(begin, end - begin); }
+        [[nodiscard]] bool is(const std::string_view src, const char c) const {
+            return kind == Kind::Punct && src[begin] == c;
+        }
+    };
+
+    class Lexer {
+    public:
+        explicit Lexer(const std::string_view src) : m_src(src) {}
+
+        // Stores the next token in tok; false at the end of the input.
+        bool next(Token& tok) {
+            skipSpace();
+            if (m_pos >= m_src.size()) return false;
+
+            const size_t start = m_pos;
+            const char c = m_src[m_pos];
+            if (c == '#' && m_lineStart) m_directive = true;
+            tok.first = m_lineStart;
+            m_lineStart = false;
+            tok.directive = m_directive;
+            tok.begin = start;
+
+            if (c == '/' && peek(1) == '/') {
+                lineComment();
+                tok.kind = Kind::Comment;
+            } else if (c == '/' && peek(1) == '*') {
+                const size_t close = m_src.find("*/", m_pos + 2);
+                m_pos = close == std::string_view::npos ? m_src.size() : close + 2;
+                tok.kind = Kind::Comment;
+            } else if (c == '"' || c == '\'') {
+                quoted(c);
+                tok.kind = Kind::String;
+            } else if (isDigit(c) || (c == '.' && isDigit(peek(1)))) {
+                number();
+                tok.kind = Kind::Number;
+            } else if (isIdentStart(c)) {
+                tok.kind = identifierOrLiteral();
+            } else {
+                ++m_pos;
+                tok.kind = Kind::Punct;
+            }
+            tok.end = m_pos;
+            return true;
+        }
+
+    private:
+        static bool isDigit(const char c) { return c >= '0' && c <= '9'; }
+        static bool isIdentStart(const char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '$' || static_cast<unsigned char>(c) >= 0x80;
+        }
+        static bool isIdent(const char c) { return isIdentStart(c) || isDigit(c); }
+
+        [[nodiscard]] char peek(const size_t ahead) const {
+            return m_pos + ahead < m_src.size() ? m_src[m_pos + ahead] : '\0';
+        }
+
+        // Length of a backslash-newline splice at pos, 0 if there is none
+        [[nodiscard]] size_t splice(const size_t pos) const {
+            if (pos >= m_src.size() || m_src[pos] != '\\') return 0;
+            if (pos + 1 < m_src.size() && m_src[pos + 1] == '\n') return 2;
+            if (pos + 2 < m_src.size() && m_src[pos + 1] == '\r' && m_src[pos + 2] == '\n') return 3;
+            return 0;
+        }
+
+        void skipSpace() {
+            while (m_pos < m_src.size()) {
+                const char c = m_src[m_pos];
+                if (c == '\n') {
+                    m_lineStart = true;
+                    m_directive = false;
+                    ++m_pos;
+                } else if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') {
+                    ++m_pos;
+                } else if (const size_t n = splice(m_pos)) {
+                    m_pos += n; // The logical line (and any directive) goes on
+                } else {
+                    return;
+                }
+            }
+        }
+
+        void lineComment() {
+            while (m_pos < m_src.size() && m_src[m_pos] != '\n') {
+                const size_t n = splice(m_pos);
+                m_pos += n ? n : 1;
+            }
+        }
+
+        // A "string" or 'c' literal; an unterminated one ends at the newline
+        void quoted(const char quote) {
+            ++m_pos;
+            while (m_pos < m_src.size()) {
+                const char c = m_src[m_pos];
+                if (c == quote) {
+                    ++m_pos;
+                    return;
+                }
+                if (c == '\n') return;
+                if (c == '\\' && m_pos + 1 < m_src.size()) {
+                    m_pos += m_src[m_pos + 1] == '\r' && m_pos + 2 < m_src.size() ? 3 : 2;
+                    continue;
+                }
+                ++m_pos;
+            }
+        }
+
+        // R"delim( ... )delim"; m_pos is on the opening quote
+        void rawString() {
+            const size_t open = m_src.find('(', m_pos + 1);
+            if (open == std::string_view::npos || open - m_pos - 1 > 16) {
+                quoted('"');
+                return;
+            }
+            std::string_view delim = m_src.substr(m_pos + 1, open - m_pos - 1);
+            for (size_t at = open + 1; (at = m_src.find(')', at)) != std::string_view::npos; ++at) {
+                if (m_src.substr(at + 1, delim.size()) == delim && at + 1 + delim.size() < m_src.size() &&
+                    m_src[at + 1 + delim.size()] == '"') {
+                    m_pos = at + delim.size() + 2;
+                    return;
+                }
+            }
+            m_pos = m_src.size();
+        }
+
+        // A pp-number: digits, letters, dots, exponent signs and digit separators
+        void number() {
+            while (m_pos < m_src.size()) {
+                const char c = m_src[m_pos];
+                if ((c == '+' || c == '-') && m_pos > 0) {
+                    const char e = m_src[m_pos - 1];
+                    if (e != 'e' && e != 'E' && e != 'p' && e != 'P') return;
+                } else if (c == '\'') {
+                    if (!isIdent(peek(1))) return;
+                } else if (!isIdent(c) && c != '.') {
+                    return;
+                }
+                ++m_pos;
+            }
+        }
+
+        // An identifier, unless it is an encoding prefix glued to a literal (L"", u8'', R"()")
+        Kind identifierOrLiteral() {
+            const size_t start = m_pos;
+            while (m_pos < m_src.size() && isIdent(m_src[m_pos])) ++m_pos;
+            if (m_pos >= m_src.size() || (m_src[m_pos] != '"' && m_src[m_pos] != '\'')) return Kind::Identifier;
+
+            const std::string_view prefix = m_src.substr(start, m_pos - start);
+            const bool raw = !prefix.empty() && prefix.back() == 'R' && m_src[m_pos] == '"';
+            const std::string_view encoding = raw ? prefix.substr(0, prefix.size() - 1) : prefix;
+            if (encoding != "" && encoding != "L" && encoding != "u" && encoding != "U" && encoding != "u8") {
+                return Kind::Identifier;
+            }
+            if (raw) rawString();
+            else quoted(m_src[m_pos]);
+            return Kind::String;
+        }
+
+        std::string_view m_src;
+        size_t m_pos = 0;
+        bool m_lineStart = true;
+        bool m_directive = false;
+    };
+
+} // namespace ctok
@@ -3,15 +3,25 @@
 #include <algorithm>
 #include <string>
 #include <filesystem>
-#include <regex>
 #include <vector>
 #include <unordered_set>
+#include <unordered_map>
+#include <mutex>
+#include <spawn.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <sstream>
 #include <sys/stat.h>
+#include <cstring>
+#include <functional>
+#include <thread>
 
+#include "command_resolver.hpp"
 #include "print.hpp"
+#include "walker.hpp"
+#include "glob.hpp"
 
 namespace fs = std::filesystem;
 
@@ -22,43 +32,252 @@ struct CommandResult {
     std::string stderr_output;
 };
 
-// Executes a command and captures its exit code, stdout, and stderr.
-inline CommandResult execute_vec(const std::vector<std::string>& args) {
+// Receives child output as it arrives: raw chunks, or one line at a time (without
+// the trailing newline) when ExecOptions::line_buffered is set. A line longer than
+// 64 KiB is passed on in pieces rather than held until its newline.
+using OutputCallback = std::function<void(std::string_view)>;
+
+struct ExecOptions {
+    OutputCallback on_stdout;
+    OutputCallback on_stderr;
+    bool line_buffered = false;
+    bool capture = true;      // Keep output in the returned CommandResult
+    size_t capture_limit = 0; // When non-zero, keep only (about) the last capture_limit bytes per stream
+    std::vector<std::string> env; // Extra NAME=value entries, overriding the inherited environment
+};
+
+// NUL-terminated argv/envp arrays packed into one reusable buffer, so repeated
+// launches from the same thread stop allocating once the arena has grown.
+class ArgvArena {
+public:
+    // Returns argv for args; valid until the next build_argv() on this arena.
+    char* const* build_argv(const std::vector<std::string>& args) {
+        pack(m_argv, args.size(), [&](const size_t i) { return std::string_view(args[i]); });
+        return m_argv.pointers.data();
+    }
+
+    // Returns the current environment with overrides applied (environ itself when there are none).
+    char* const* build_envp(const std::vector<std::string>& overrides) {
+        if (overrides.empty()) return environ;
+        m_scratch.clear();
+        for (char** e = environ; *e; ++e) {
+            const std::string_view entry(*e);
+            const std::string_view name = entry.substr(0, entry.find('='));
+            const bool replaced = std::ranges::any_of(overrides, [&](const std::string& o) {
+                return o.size() > name.size() && o.compare(0, name.size(), name) == 0 && o[name.size()] == '=';
+            });
+            if (!replaced) m_scratch.push_back(entry);
+        }
+        for (const auto& o : overrides) m_scratch.emplace_back(o);
+        pack(m_envp, m_scratch.size(), [&](const size_t i) { return m_scratch[i]; });
+        return m_envp.pointers.data();
+    }
+
+private:
+    struct Block {
+        std::string buffer;
+        std::vector<char*> pointers;
+    };
+
+    template<typename Get>
+    static void pack(Block& block, const size_t count, const Get& get) {
+        size_t total = 0;
+        for (size_t i = 0; i < count; ++i) total += get(i).size() + 1;
+        block.buffer.resize(total);
+        block.pointers.resize(count + 1);
+        char* out = block.buffer.data();
+        for (size_t i = 0; i < count; ++i) {
+            const std::string_view s = get(i);
+            std::memcpy(out, s.data(), s.size());
+            out[s.size()] = '\0';
+            block.pointers[i] = out;
+            out += s.size() + 1;
+        }
+        block.pointers[count] = nullptr;
+    }
+
+    Block m_argv;
+    Block m_envp;
+    std::vector<std::string_view> m_scratch;
+};
+
+// Resolves a command name to an executable path the way execvp would, from the shared
+// CommandResolver table. Names containing '/' are returned unchanged.
+inline std::string resolve_executable(const std::string& name) {
+    return CommandResolver::instance().resolve(name);
+}
+
+// Launches args with stdout/stderr redirected to out_fd/err_fd through posix_spawn,
+// which glibc implements with CLONE_VM|CLONE_VFORK, so the cost does not grow with
+// dvk's own memory size. Returns 0 on success or an errno value.
+inline int spawn_process(const std::vector<std::string>& args, const int out_fd, const int err_fd, pid_t& pid,
+                         const std::vector<std::string>& env = {}) {
+    if (args.empty()) return EINVAL;
+    const std::string path = resolve_executable(args[0]);
+    if (path.empty()) return ENOENT;
+
+    thread_local ArgvArena arena;
+    char* const* argv = arena.build_argv(args);
+    char* const* envp = arena.build_envp(env);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, err_fd, STDERR_FILENO);
+    const int rc = posix_spawn(&pid, path.c_str(), &actions, nullptr, argv, envp);
+    posix_spawn_file_actions_destroy(&actions);
+    return rc;
+}
+
+namespace detail {
+    // One child pipe being drained: forwards data to the callback and the bounded capture.
+    class OutputPump {
+    public:
+        OutputPump(const int fd, const OutputCallback& callback, std::string& capture, const ExecOptions& options)
+            : m_fd(fd), m_callback(callback), m_capture(capture), m_options(options) {}
+
+        [[nodiscard]] int fd() const { return m_fd; }
+        void attach(const int fd) { m_fd = fd; }
+
+        // Reads whatever is available; returns false once the pipe hit EOF and was closed.
+        bool drain(char* buf, const size_t size) {
+            const ssize_t n = read(m_fd, buf, size);
+            if (n < 0 && (errno == EINTR || errno == EAGAIN)) return true;
+            if (n <= 0) {
+                finish();
+                return false;
+            }
+            feed(std::string_view(buf, static_cast<size_t>(n)));
+            return true;
+        }
+
+        void finish() {
+            if (m_fd < 0) return;
+            close(m_fd);
+            m_fd = -1;
+            if (!m_partial.empty()) {
+                m_callback(m_partial);
+                m_partial.clear();
+            }
+        }
+
+    private:
+        void feed(std::string_view data) {
+            if (m_options.capture) {
+                m_capture.append(data);
+                // Trim in bulk so the capture stays under 2x the limit with amortised O(1) cost
+                if (m_options.capture_limit && m_capture.size() > 2 * m_options.capture_limit) {
+                    m_capture.erase(0, m_capture.size() - m_options.capture_limit);
+                }
+            }
+            if (!m_callback) return;
+            if (!m_options.line_buffered) {
+                m_callback(data);
+                return;
+            }
+            size_t nl;
+            while ((nl = data.find('\n')) != std::string_view::npos) {
+                if (m_partial.empty()) {
+                    m_callback(data.substr(0, nl));
+                } else {
+                    m_partial.append(data.substr(0, nl));
+                    m_callback(m_partial);
+                    m_partial.clear();
+                }
+                data.remove_prefix(nl + 1);
+            }
+            m_partial.append(data);
+            // Output that never ends a line must not grow the buffer without bound
+            if (m_partial.size() >= kMaxPartialLine) {
+                std::string_view rest(m_partial);
+                for (; rest.size() >= kMaxPartialLine; rest.remove_prefix(kMaxPartialLine)) {
+                    m_callback(rest.substr(0, kMaxPartialLine));
+                }
+                m_partial.erase(0, m_partial.size() - rest.size());
+            }
+        }
+
+        static constexpr size_t kMaxPartialLine = 64 * 1024;
+
+        int m_fd;
+        const OutputCallback& m_callback;
+        std::string& m_capture;
+        const ExecOptions& m_options;
+        std::string m_partial;
+    };
+
+    inline int decode_status(const int status) {
+        if (WIFEXITED(status)) return WEXITSTATUS(status);
+        if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+        return -1;
+    }
+}
+
+// Runs a command, multiplexing its stdout and stderr with poll so neither pipe
+// can fill up and stall the child, and streaming both to the option callbacks.
+inline CommandResult execute_stream(const std::vector<std::string>& args, const ExecOptions& options) {
+    CommandResult result{-1, "", ""};
+    if (args.empty()) return result;
+    const profile::ScopedTimer timer(profile::Phase::Spawn);
+    uint64_t syscalls = 5; // pipe2 (x2), spawn, closing the write ends
+
     int stdout_pipe[2], stderr_pipe[2];
-    pipe(stdout_pipe);
-    pipe(stderr_pipe);
-
-    const pid_t pid = fork();
-    if (pid == 0) {
-        // Child
-        dup2(stdout_pipe[1], STDOUT_FILENO);
-        dup2(stderr_pipe[1], STDERR_FILENO);
+    if (pipe2(stdout_pipe, O_CLOEXEC) != 0) {
+        result.stderr_output = std::strerror(errno);
+        return result;
+    }
+    if (pipe2(stderr_pipe, O_CLOEXEC) != 0) {
+        result.stderr_output = std::strerror(errno);
         close(stdout_pipe[0]); close(stdout_pipe[1]);
-        close(stderr_pipe[0]); close(stderr_pipe[1]);
-
-        std::vector<char*> argv;
-        for (const auto& s : args) argv.push_back(const_cast<char*>(s.c_str()));
-        argv.push_back(nullptr);
-        execvp(argv[0], argv.data());
-        _exit(127); // exec failed
+        return result;
     }
 
-    // Parent
+    pid_t pid = -1;
+    const int spawn_error = spawn_process(args, stdout_pipe[1], stderr_pipe[1], pid, options.env);
     close(stdout_pipe[1]);
     close(stderr_pipe[1]);
-    std::string stdout_result, stderr_result;
-    char buf[4096];
-    ssize_t n;
-    while ((n = read(stdout_pipe[0], buf, sizeof(buf))) > 0)
-        stdout_result.append(buf, n);
-    while ((n = read(stderr_pipe[0], buf, sizeof(buf))) > 0)
-        stderr_result.append(buf, n);
-    close(stdout_pipe[0]);
-    close(stderr_pipe[0]);
+    if (spawn_error != 0) {
+        // Report like a shell would for a command that could not be executed
+        result.exit_code = spawn_error == ENOENT ? 127 : 126;
+        result.stderr_output = fmt::format("{}: {}", args[0], std::strerror(spawn_error));
+        close(stdout_pipe[0]);
+        close(stderr_pipe[0]);
+        profile::count(profile::Phase::Spawn, syscalls + 2);
+        return result;
+    }
+
+    detail::OutputPump pumps[2] = {
+        {stdout_pipe[0], options.on_stdout, result.stdout_output, options},
+        {stderr_pipe[0], options.on_stderr, result.stderr_output, options},
+    };
+    char buf[64 * 1024];
+    int open_pipes = 2;
+    while (open_pipes > 0) {
+        pollfd fds[2] = {{pumps[0].fd(), POLLIN, 0}, {pumps[1].fd(), POLLIN, 0}};
+        ++syscalls;
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < 2; ++i) {
+            if (fds[i].fd < 0 || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            ++syscalls;
+            if (!pumps[i].drain(buf, sizeof(buf))) --open_pipes;
+        }
+    }
+    pumps[0].finish();
+    pumps[1].finish();
 
     int status = 0;
-    waitpid(pid, &status, 0);
-    return {WEXITSTATUS(status), stdout_result, stderr_result};
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    result.exit_code = detail::decode_status(status);
+    profile::count(profile::Phase::Spawn, syscalls + 3, result.stdout_output.size() + result.stderr_output.size());
+    return result;
+}
+
+// Executes a command and captures its exit code, stdout, and stderr.
+inline CommandResult execute_vec(const std::vector<std::string>& args) {
+    return execute_stream(args, {});
 }
 
 // Simple whitespace split (does not handle quotes/escapes)
@@ -107,142 +326,89 @@ inline bool matches_pattern(const std::string& filename, const std::string& patt
 
 
 
-inline std::vector<fs::path> find_source_files(const fs::path& dir,
-                                              const std::unordered_set<std::string>& ignored_dirs,
-                                              const std::vector<std::string>& exclude_patterns = {}) {
-    std::vector<fs::path> files;
-    if (!fs::exists(dir)) return files;
-
-    try {
-        for (const auto& entry : fs::recursive_directory_iterator(dir, fs::directory_options::skip_permission_denied)) {
-            // Check if any component in the path is in ignored dirs
-            bool is_in_ignored_dir = false;
-            for (const auto& part : entry.path()) {
-                if (ignored_dirs.contains(part.string())) {
-                    is_in_ignored_dir = true;
-                    break;
-                }
-            }
+inline bool is_source_extension(const std::string_view name) {
+    const size_t dot = name.rfind('.');
+    if (dot == std::string_view::npos || dot == 0) return false;
+    const std::string_view ext = name.substr(dot);
+    return ext == ".cpp" || ext == ".c" || ext == ".cc" || ext == ".s" ||
+           ext == ".S" || ext == ".asm" || ext == ".c++" || ext == ".cxx";
+}
 
-            if (is_in_ignored_dir) {
-                continue;
+// Streams every source file under dir to on_file. Ignored directories are pruned
+// before they are opened; on_file is called concurrently from the walker threads.
+inline void for_each_source_file(const fs::path& dir,
+                                 const std::unordered_set<std::string>& ignored_dirs,
+                                 const std::vector<std::string>& exclude_patterns,
+                                 const std::function<void(const WalkEntry&)>& on_file) {
+    // Transparent copy of the ignore set so entry names can be looked up without allocating
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(const std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+    const std::unordered_set<std::string, NameHash, std::equal_to<>> ignored(ignored_dirs.begin(), ignored_dirs.end());
+    const GlobSet excludes(exclude_patterns);
+
+    WalkOptions options;
+    options.on_error = [&dir](const std::string& rel, const int err) {
+        print::warn("Filesystem error while scanning '{}': {}", (dir / rel).string(), std::strerror(err));
+    };
+    DirWalker walker(std::move(options));
+    walker.walk(dir, [&](const WalkEntry& entry) {
+        int excluded = -1;
+        bool candidate;
+        {
+            const profile::ScopedTimer timer(profile::Phase::Match);
+            if (ignored.contains(entry.name)) return false;
+            candidate = (entry.is_file() || entry.is_symlink() || entry.type == DT_UNKNOWN) &&
+                        is_source_extension(entry.name);
+            // Symlinked sources count when they lead to a regular file, as they did for
+            // directory_iterator; only those entries pay for the extra stat
+            if (candidate && !entry.is_file()) {
+                struct stat st{};
+                candidate = fstatat(entry.dir_fd, entry.name.data(), &st, 0) == 0 && S_ISREG(st.st_mode);
             }
+            if (candidate) excluded = excludes.match(entry.name);
+        }
+        if (!candidate) return true;
 
-            // Check if it's a source file
-            if (entry.is_regular_file()) {
-                if (const std::string ext = entry.path().extension().string();
-                    ext == ".cpp" || ext == ".c" || ext == ".cc" || ext == ".s" ||
-                    ext == ".S" || ext == ".asm" || ext == ".c++" || ext == ".cxx") {
-
-                    // NEW: Check exclude patterns
-                    const std::string filename = entry.path().filename().string();
-                    bool should_exclude = false;
-
-                    for (const auto& pattern : exclude_patterns) {
-                        if (matches_pattern(filename, pattern)) {
-                            should_exclude = true;
-                            print::warn("Excluding file '{}' (matches pattern '{}')", filename, pattern);
-                            break;
-                        }
-                    }
-
-                    if (!should_exclude) {
-                        files.push_back(entry.path());
-                    }
-                }
-            }
+        if (excluded >= 0) {
+            print::warn("Excluding file '{}' (matches pattern '{}')", entry.name, excludes.pattern(excluded));
+            return true;
         }
-    } catch(const fs::filesystem_error& e) {
-        print::warn("Filesystem error while scanning: {}", e.what());
+        on_file(entry);
+        return true;
+    });
+}
+
+inline std::vector<fs::path> find_source_files(const fs::path& dir,
+                                              const std::unordered_set<std::string>& ignored_dirs,
+                                              const std::vector<std::string>& exclude_patterns = {}) {
+    const profile::ScopedTimer timer(profile::Phase::None, "find_source_files");
+    std::vector<fs::path> files;
+    if (!fs::is_directory(dir)) return files;
+
+    // One chunk per walker thread, merged once the walk is done
+    std::vector<std::vector<fs::path>> chunks(DirWalker::default_threads());
+    for_each_source_file(dir, ignored_dirs, exclude_patterns, [&](const WalkEntry& entry) {
+        chunks[entry.worker].push_back(dir / entry.rel_path());
+    });
+
+    size_t total = 0;
+    for (const auto& chunk : chunks) total += chunk.size();
+    files.reserve(total);
+    for (auto& chunk : chunks) {
+        std::ranges::move(chunk, std::back_inserter(files));
     }
+    std::ranges::sort(files);
     return files;
 }
 
 inline bool isCommandExecutable(const std::string& command) {
-    // 1. Input validation: reject empty or dangerous patterns
-    if (command.empty()) {
-        return false;
-    }
-
-    // Reject commands with null bytes or control characters
-    if (command.find('\0') != std::string::npos ||
-        std::ranges::any_of(command, [](const char c) { return c < 32 || c > 126; })) {
+    // Reject control characters, non-ASCII bytes and embedded NULs outright
+    if (command.empty() || std::ranges::any_of(command, [](const char c) { return c < 32 || c > 126; })) {
         return false;
     }
-
-    // Prevent obvious traversal in direct paths (not foolproof, but adds safety)
-    if (std::regex traversal_pattern(R"(\.\./|\.\.$|^/[^/]*\.\./)"); std::regex_search(command, traversal_pattern)) {
-        // Allow if it's a relative executable like "./script", but not "../"
-        if (command.find("../") != std::string::npos) {
-            return false;
-        }
-        if (command == ".." || command == "../") {
-            return false;
-        }
-    }
-
-    std::vector<std::string> search_paths;
-
-    // 2. If command contains '/' -> treat as path (absolute or relative)
-    if (command.find('/') != std::string::npos) {
-        search_paths.emplace_back(""); // Will test the command directly
-    } else {
-        // Else, search in PATH
-        const char* path_env = std::getenv("PATH");
-        if (!path_env) return false;
-
-        std::string path_str(path_env);
-        std::regex token_regex("[^:]+");
-        auto begin = std::sregex_iterator(path_str.begin(), path_str.end(), token_regex);
-        auto end = std::sregex_iterator();
-
-        for (std::sregex_iterator i = begin; i != end; ++i) {
-            std::string dir = i->str();
-
-            // Sanitize PATH entry (prevent weird stuff)
-            if (dir.empty() || dir.length() >= PATH_MAX) {
-                continue;
-            }
-
-            // Prevent traversal in PATH entries
-            if (dir.find("..") != std::string::npos) {
-                continue;
-            }
-
-            search_paths.push_back(dir);
-        }
-    }
-
-    // 3. Try each possible path
-    for (const auto& dir : search_paths) {
-        std::string full_path = dir.empty() ? command : dir + "/" += command;
-
-        // Skip if path is too long
-        if (full_path.length() >= PATH_MAX) {
-            continue;
-        }
-
-        // 4. Resolve symbolic links and get canonical path (avoid loops)
-        char resolved_path[PATH_MAX];
-        if (realpath(full_path.c_str(), resolved_path) == nullptr) {
-            continue; // Doesn't exist, broken symlink, or access denied
-        }
-
-        // 5. Stat the file to ensure it's a regular file or symlink to one
-        struct stat sb{};
-        if (stat(resolved_path, &sb) != 0) {
-            continue;
-        }
-
-        if (!S_ISREG(sb.st_mode)) {
-            continue; // Not a regular file (e.g., directory, device)
-        }
-
-        // 6. Check execute permission for user
-        if (access(resolved_path, X_OK) == 0) {
-            return true;
-        }
-    }
-
-    return false;
-}
\ No newline at end of file
+    // No traversal through parent directories ("./script" is fine, "../script" is not)
+    if (command == ".." || command.find("../") != std::string::npos) return false;
+    return CommandResolver::instance().executable(command);
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "profile.hpp"
+#include "uring.hpp"
+
+// Creating many small files at once.
+//
+// write_files() creates each file with O_CREAT|O_EXCL and writes it with a single
+// write. Where io_uring is available, every file becomes one linked openat -> write
+// -> close chain on a direct descriptor, and up to kWave files are submitted per
+// io_uring_enter. Otherwise, or when the kernel rejects direct descriptors, it falls
+// back to openat/write/close per file.
+
+struct FileWrite {
+    int dir_fd;
+    const char* name;      // Relative to dir_fd
+    std::string_view data; // Must stay valid until write_files returns
+    mode_t mode = 0644;
+    int error = 0;         // errno for this file once written, 0 on success
+};
+
+namespace filebatch::detail {
+
+    // Files per submission; each uses three SQEs and one direct descriptor slot
+    inline constexpr unsigned kWave = 64;
+
+    // Writes data to name with plain syscalls; returns 0 or errno.
+    inline int writeSync(const int dir_fd, const char* name, const std::string_view data, const mode_t mode, const int flags) {
+        const int fd = openat(dir_fd, name, O_WRONLY | O_CLOEXEC | flags, mode);
+        if (fd < 0) return errno;
+        size_t written = 0;
+        while (written < data.size()) {
+            const ssize_t n = write(fd, data.data() + written, data.size() - written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                const int err = n < 0 ? errno : EIO;
+                close(fd);
+                return err;
+            }
+            written += static_cast<size_t>(n);
+        }
+        return close(fd) == 0 ? 0 : errno;
+    }
+
+    enum Step : uint64_t { Open, Write, Close };
+
+    // What the plain-syscall pass still has to do for a file
+    enum Redo : uint8_t { Done, Rewrite, Create };
+
+    // Submits files[begin, end) as linked chains. Returns false if the kernel rejected
+    // the chain itself (no direct descriptors before 5.15); those files are marked Create.
+    inline bool writeWave(Uring& ring, std::vector<FileWrite>& files, const size_t begin, const size_t end,
+                          std::vector<uint8_t>& redo) {
+        for (size_t i = begin; i < end; ++i) {
+            const auto slot = static_cast<unsigned>(i - begin);
+            const uint64_t tag = static_cast<uint64_t>(i) << 2;
+            FileWrite& f = files[i];
+
+            io_uring_sqe* open = ring.next();
+            open->opcode = IORING_OP_OPENAT;
+            open->fd = f.dir_fd;
+            open->addr = reinterpret_cast<uint64_t>(f.name);
+            open->len = f.mode;
+            open->open_flags = O_WRONLY | O_CREAT | O_EXCL; // No O_CLOEXEC: direct descriptors are never exec'd
+            open->file_index = slot + 1;
+            open->flags = IOSQE_IO_LINK;
+            open->user_data = tag | Open;
+
+            io_uring_sqe* write = ring.next();
+            write->opcode = IORING_OP_WRITE;
+            write->fd = static_cast<int>(slot);
+            write->addr = reinterpret_cast<uint64_t>(f.data.data());
+            write->len = static_cast<uint32_t>(f.data.size());
+            write->off = 0;
+            write->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+            write->user_data = tag | Write;
+
+            io_uring_sqe* close = ring.next();
+            close->opcode = IORING_OP_CLOSE;
+            close->file_index = slot + 1;
+            close->user_data = tag | Close;
+        }
+
+        const unsigned expected = static_cast<unsigned>(end - begin) * 3;
+        unsigned seen = 0;
+        bool unsupported = false;
+        if (ring.submit(expected) < 0) {
+            std::fill(redo.begin() + static_cast<ptrdiff_t>(begin), redo.begin() + static_cast<ptrdiff_t>(end), Create);
+            return false;
+        }
+        profile::count(profile::Phase::Copy, 1);
+        while (true) {
+            seen += ring.reap([&](const uint64_t user_data, const int res) {
+                const size_t i = user_data >> 2;
+                FileWrite& f = files[i];
+                switch (user_data & 3) {
+                    case Open:
+                        if (res == -EINVAL || res == -EOPNOTSUPP) {
+                            unsupported = true;
+                            redo[i] = Create;
+                        } else if (res < 0) {
+                            f.error = -res;
+                        }
+                        break;
+                    case Write:
+                        // A short write is finished with plain syscalls after the wave
+                        if (res >= 0 && static_cast<size_t>(res) != f.data.size()) redo[i] = Rewrite;
+                        else if (res < 0 && res != -ECANCELED && !f.error) f.error = -res;
+                        break;
+                    default:
+                        if (res < 0 && res != -ECANCELED && !f.error) f.error = -res;
+                        break;
+                }
+            });
+            if (seen >= expected) break;
+            if (ring.submit(1) < 0) break;
+        }
+        return !unsupported;
+    }
+
+} // namespace filebatch::detail
+
+// Creates and writes every file; sets each FileWrite::error and returns how many failed.
+inline size_t write_files(std::vector<FileWrite>& files) {
+    using namespace filebatch::detail;
+    const profile::ScopedTimer timer(profile::Phase::Copy);
+    // Everything starts as Create; waves the ring completes reset it
+    std::vector<uint8_t> redo(files.size(), Create);
+
+    Uring* ring = Uring::forThread(kWave * 4, kWave);
+    for (size_t begin = 0; ring && begin < files.size(); begin += kWave) {
+        const size_t end = std::min(files.size(), begin + kWave);
+        bool fits = true;
+        for (size_t i = begin; i < end; ++i) fits &= files[i].data.size() <= UINT32_MAX;
+        if (!fits) continue; // Huge files take the plain path below
+        std::fill(redo.begin() + static_cast<ptrdiff_t>(begin), redo.begin() + static_cast<ptrdiff_t>(end), Done);
+        if (!writeWave(*ring, files, begin, end, redo)) {
+            Uring::disableForThread();
+            break;
+        }
+    }
+
+    uint64_t bytes = 0;
+    size_t failed = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        FileWrite& f = files[i];
+        if (redo[i] != Done && !f.error) {
+            f.error = writeSync(f.dir_fd, f.name, f.data, f.mode, redo[i] == Create ? O_CREAT | O_EXCL : O_TRUNC);
+            profile::count(profile::Phase::Copy, 3);
+        }
+        if (f.error) ++failed;
+        else bytes += f.data.size();
+    }
+    profile::count(profile::Phase::Copy, 0, bytes);
+    return failed;
+}
@@ -1,10 +1,9 @@
 #pragma once
 #include <string>
+#include "template.hpp"
 
+// Replaces every occurrence of toSearch, left to right, in one linear pass
 inline void findAndReplaceAll(std::string& data, const std::string& toSearch, const std::string& replaceStr) {
-    size_t pos = data.find(toSearch);
-    while (pos != std::string::npos) {
-        data.replace(pos, toSearch.size(), replaceStr);
-        pos = data.find(toSearch, pos + replaceStr.size());
-    }
-}
\ No newline at end of file
+    if (toSearch.empty()) return;
+    data = tmpl::render<1>(data, {toSearch}, {replaceStr});
+}
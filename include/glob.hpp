@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A set of glob patterns compiled once and matched together.
+//
+// Supported syntax: '*' (any run of characters except '/'), '?' (one character
+// except '/'), '[...]' classes with ranges and '!'/'^' negation, '**' (any run
+// including '/'; "**/" also matches nothing) and '\' escapes.
+//
+// Patterns are split into three buckets so a name is tested against all of them
+// in one pass without allocating:
+//   - literals ("build", ".git")    -> one hash lookup
+//   - plain suffixes ("*.o", "*~")  -> one backward walk of a reversed trie
+//   - everything else               -> bit-parallel NFA, all patterns stepped together
+// A pattern of 64 or more tokens doesn't fit the NFA's word; it gets the same automaton
+// with a byte per state, matched on its own and allocating per call.
+class GlobSet {
+public:
+    GlobSet() = default;
+
+    explicit GlobSet(const std::vector<std::string>& patterns) {
+        for (const auto& p : patterns) add(p);
+    }
+
+    // Adds a pattern; its index is the number of patterns added before it.
+    void add(const std::string_view pattern) {
+        const int index = static_cast<int>(m_patterns.size());
+        m_patterns.emplace_back(pattern);
+
+        if (pattern.find_first_of("*?[\\") == std::string_view::npos) {
+            m_literals.try_emplace(std::string(pattern), index);
+        } else if (pattern.size() > 1 && pattern[0] == '*' &&
+                   pattern.find_first_of("*?[\\", 1) == std::string_view::npos) {
+            addSuffix(pattern.substr(1), index);
+        } else {
+            compileGeneral(pattern, index);
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return m_patterns.size(); }
+    [[nodiscard]] bool empty() const { return m_patterns.empty(); }
+    [[nodiscard]] const std::string& pattern(const int index) const { return m_patterns[static_cast<size_t>(index)]; }
+
+    [[nodiscard]] bool matches(const std::string_view name) const { return match(name) >= 0; }
+
+    // Index of the first pattern (in insertion order) matching name, or -1.
+    [[nodiscard]] int match(const std::string_view name) const {
+        int best = -1;
+        const auto better = [&best](const int index) {
+            if (best < 0 || index < best) best = index;
+        };
+
+        if (!m_literals.empty()) {
+            if (const auto it = m_literals.find(name); it != m_literals.end()) better(it->second);
+        }
+
+        if (m_trie.size() > 1) {
+            // '*' must not swallow a '/', so the suffix has to start at or before the first slash
+            const size_t first_slash = name.find('/');
+            uint32_t node = 0;
+            for (size_t i = name.size(); i-- > 0;) {
+                node = child(node, static_cast<unsigned char>(name[i]));
+                if (node == kNoNode) break;
+                if (const int index = m_trie[node].pattern; index >= 0 && first_slash >= i) better(index);
+            }
+        }
+
+        for (size_t start = 0; start < m_nfas.size(); start += kBatch) {
+            const size_t count = std::min(kBatch, m_nfas.size() - start);
+            matchBatch(name, start, count, better, best);
+        }
+        for (const WideNfa& nfa : m_wide) {
+            if ((best < 0 || nfa.index < best) && matchWide(nfa, name)) better(nfa.index);
+        }
+        return best;
+    }
+
+private:
+    static constexpr size_t kBatch = 32;
+    static constexpr uint32_t kNoNode = UINT32_MAX;
+
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(const std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    struct TrieNode {
+        int pattern = -1; // Lowest pattern index whose suffix ends here
+        std::vector<std::pair<unsigned char, uint32_t>> edges;
+    };
+
+    // One compiled pattern element: the characters it consumes and its epsilon moves.
+    struct Token {
+        std::bitset<256> advance; // Consumed, moving on to the next token
+        std::bitset<256> stay;    // Consumed, staying on this token
+        bool skip1 = false;       // Epsilon move to the next token
+        bool skip2 = false;       // Epsilon move over the next token
+    };
+
+    // Patterns of 64 tokens or more, matched a token at a time instead of a word at a time
+    struct WideNfa {
+        std::vector<Token> tokens;
+        int index = -1;
+    };
+
+    // Shift-and automaton: bit i set means the first i tokens have been matched.
+    struct Nfa {
+        uint64_t advance[256]{}; // Tokens that consume the character and move on
+        uint64_t stay[256]{};    // Star tokens that consume the character and stay
+        uint64_t skip1 = 0;      // States with an epsilon move to the next state
+        uint64_t skip2 = 0;      // States with an epsilon move over the next state
+        uint64_t start = 1;      // Initial state after epsilon closure
+        uint64_t accept = 0;
+        int index = -1;
+
+        [[nodiscard]] uint64_t closure(uint64_t m) const {
+            while (true) {
+                const uint64_t next = m | ((m & skip1) << 1) | ((m & skip2) << 2);
+                if (next == m) return m;
+                m = next;
+            }
+        }
+    };
+
+    [[nodiscard]] uint32_t child(const uint32_t node, const unsigned char c) const {
+        for (const auto& [ch, next] : m_trie[node].edges) {
+            if (ch == c) return next;
+        }
+        return kNoNode;
+    }
+
+    void addSuffix(const std::string_view suffix, const int index) {
+        if (m_trie.empty()) m_trie.emplace_back();
+        uint32_t node = 0;
+        for (size_t i = suffix.size(); i-- > 0;) {
+            const auto c = static_cast<unsigned char>(suffix[i]);
+            uint32_t next = child(node, c);
+            if (next == kNoNode) {
+                next = static_cast<uint32_t>(m_trie.size());
+                m_trie[node].edges.emplace_back(c, next);
+                m_trie.emplace_back();
+            }
+            node = next;
+        }
+        if (m_trie[node].pattern < 0) m_trie[node].pattern = index;
+    }
+
+    void compileGeneral(const std::string_view pattern, const int index) {
+        std::vector<Token> tokens;
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            const char c = pattern[i];
+            if (c == '*') {
+                const bool globstar = i + 1 < pattern.size() && pattern[i + 1] == '*';
+                if (globstar) {
+                    i += 1;
+                    while (i + 1 < pattern.size() && pattern[i + 1] == '*') ++i;
+                }
+                if (globstar && i + 1 < pattern.size() && pattern[i + 1] == '/') {
+                    // "**/" is (.*/)?: an entry state that either skips the whole group or
+                    // enters a loop state, which leaves the group only through a slash
+                    Token& entry = tokens.emplace_back();
+                    entry.skip1 = entry.skip2 = true;
+                    Token& loop = tokens.emplace_back();
+                    loop.stay.set();
+                    loop.advance.set('/');
+                    i += 1;
+                    continue;
+                }
+                Token& star = tokens.emplace_back();
+                star.stay.set();
+                if (!globstar) star.stay.reset('/');
+                star.skip1 = true;
+            } else if (c == '?') {
+                Token& any = tokens.emplace_back();
+                any.advance.set();
+                any.advance.reset('/');
+            } else if (const size_t close = c == '[' ? classEnd(pattern, i) : std::string_view::npos;
+                       close != std::string_view::npos) {
+                Token& cls = tokens.emplace_back();
+                parseClass(pattern, i, close, cls.advance);
+                cls.advance.reset('/');
+                i = close;
+            } else {
+                char literal = c;
+                if (c == '\\' && i + 1 < pattern.size()) literal = pattern[++i];
+                tokens.emplace_back().advance.set(static_cast<unsigned char>(literal));
+            }
+        }
+
+        // State i means "i tokens matched", so the accept state needs bit tokens.size()
+        if (tokens.size() >= 64) {
+            m_wide.push_back({std::move(tokens), index});
+            return;
+        }
+        Nfa nfa;
+        nfa.index = index;
+        for (size_t t = 0; t < tokens.size(); ++t) {
+            const uint64_t bit = uint64_t{1} << t;
+            for (int ch = 0; ch < 256; ++ch) {
+                if (tokens[t].advance[ch]) nfa.advance[ch] |= bit;
+                if (tokens[t].stay[ch]) nfa.stay[ch] |= bit;
+            }
+            if (tokens[t].skip1) nfa.skip1 |= bit;
+            if (tokens[t].skip2) nfa.skip2 |= bit;
+        }
+        nfa.accept = uint64_t{1} << tokens.size();
+        nfa.start = nfa.closure(1);
+        m_nfas.push_back(nfa);
+    }
+
+    // The same automaton as Nfa with one byte per state, for patterns too long for a word
+    static bool matchWide(const WideNfa& nfa, const std::string_view name) {
+        const std::vector<Token>& tokens = nfa.tokens;
+        std::vector<uint8_t> states(tokens.size() + 1, 0), next(tokens.size() + 1, 0);
+        // Epsilon moves only go forward, so one ascending pass is a full closure
+        const auto closure = [&tokens](std::vector<uint8_t>& s) {
+            for (size_t t = 0; t < tokens.size(); ++t) {
+                if (!s[t]) continue;
+                if (tokens[t].skip1) s[t + 1] = 1;
+                if (tokens[t].skip2 && t + 2 < s.size()) s[t + 2] = 1;
+            }
+        };
+        states[0] = 1;
+        closure(states);
+        for (const char ch : name) {
+            const auto c = static_cast<unsigned char>(ch);
+            std::fill(next.begin(), next.end(), 0);
+            bool live = false;
+            for (size_t t = 0; t < tokens.size(); ++t) {
+                if (!states[t]) continue;
+                if (tokens[t].advance[c]) next[t + 1] = live = true;
+                if (tokens[t].stay[c]) next[t] = live = true;
+            }
+            if (!live) return false;
+            closure(next);
+            states.swap(next);
+        }
+        return states.back() != 0;
+    }
+
+    // Index of the ']' closing the class opened at pattern[open], or npos when there is
+    // none and the '[' is an ordinary character, as for fnmatch. A ']' straight after the
+    // '[' or its negation is a member, and an escaped ']' never closes the class.
+    static size_t classEnd(const std::string_view pattern, const size_t open) {
+        size_t i = open + 1;
+        if (i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^')) ++i;
+        if (i < pattern.size() && pattern[i] == ']') ++i;
+        for (; i < pattern.size(); ++i) {
+            if (pattern[i] == '\\') ++i;
+            else if (pattern[i] == ']') return i;
+        }
+        return std::string_view::npos;
+    }
+
+    // Fills set from the class between pattern[open] ('[') and pattern[close] (its ']').
+    static void parseClass(const std::string_view pattern, const size_t open, const size_t close,
+                           std::bitset<256>& set) {
+        size_t i = open + 1;
+        const bool negate = pattern[i] == '!' || pattern[i] == '^';
+        if (negate) ++i;
+        for (; i < close; ++i) {
+            auto lo = static_cast<unsigned char>(pattern[i]);
+            if (lo == '\\' && i + 1 < close) lo = static_cast<unsigned char>(pattern[++i]);
+            if (i + 2 < close && pattern[i + 1] == '-') {
+                // Either end of a range may be escaped
+                size_t end = i + 2;
+                if (pattern[end] == '\\' && end + 1 < close) ++end;
+                const auto hi = static_cast<unsigned char>(pattern[end]);
+                for (unsigned ch = lo; ch <= hi; ++ch) set.set(ch);
+                i = end;
+            } else {
+                set.set(lo);
+            }
+        }
+        if (negate) set.flip();
+    }
+
+    template<typename Better>
+    void matchBatch(const std::string_view name, const size_t first, const size_t count,
+                    const Better& better, const int& best) const {
+        uint64_t states[kBatch];
+        uint64_t live = 0; // Bit j set while pattern first + j can still match
+        for (size_t j = 0; j < count; ++j) {
+            states[j] = m_nfas[first + j].start;
+            if (best < 0 || m_nfas[first + j].index < best) live |= uint64_t{1} << j;
+        }
+
+        for (size_t i = 0; i < name.size() && live; ++i) {
+            const auto c = static_cast<unsigned char>(name[i]);
+            for (uint64_t pending = live; pending; pending &= pending - 1) {
+                const auto j = static_cast<size_t>(__builtin_ctzll(pending));
+                const Nfa& nfa = m_nfas[first + j];
+                const uint64_t s = states[j];
+                const uint64_t next = ((s & nfa.advance[c]) << 1) | (s & nfa.stay[c]);
+                states[j] = next ? nfa.closure(next) : 0;
+                if (!states[j]) live &= ~(uint64_t{1} << j);
+            }
+        }
+
+        for (uint64_t pending = live; pending; pending &= pending - 1) {
+            const auto j = static_cast<size_t>(__builtin_ctzll(pending));
+            if (states[j] & m_nfas[first + j].accept) better(m_nfas[first + j].index);
+        }
+    }
+
+    std::vector<std::string> m_patterns;
+    std::unordered_map<std::string, int, NameHash, std::equal_to<>> m_literals;
+    std::vector<TrieNode> m_trie;
+    std::vector<Nfa> m_nfas;
+    std::vector<WideNfa> m_wide;
+};
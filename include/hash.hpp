@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <cerrno>
+#include <fmt/core.h>
+#include <unistd.h>
+
+// Streaming XXH64 (https://github.com/Cyan4973/xxHash), used to fingerprint file
+// contents for manifests. Not cryptographic; fast enough to run at memory speed.
+class Xxh64 {
+public:
+    explicit Xxh64(const uint64_t seed = 0) { reset(seed); }
+
+    void reset(const uint64_t seed = 0) {
+        m_v[0] = seed + kP1 + kP2;
+        m_v[1] = seed + kP2;
+        m_v[2] = seed;
+        m_v[3] = seed - kP1;
+        m_seed = seed;
+        m_total = 0;
+        m_bufferSize = 0;
+    }
+
+    void update(const void* data, size_t size) {
+        auto p = static_cast<const unsigned char*>(data);
+        m_total += size;
+        if (m_bufferSize + size < 32) {
+            std::memcpy(m_buffer + m_bufferSize, p, size);
+            m_bufferSize += size;
+            return;
+        }
+        if (m_bufferSize > 0) {
+            const size_t fill = 32 - m_bufferSize;
+            std::memcpy(m_buffer + m_bufferSize, p, fill);
+            stripe(m_buffer);
+            p += fill;
+            size -= fill;
+            m_bufferSize = 0;
+        }
+        for (; size >= 32; p += 32, size -= 32) stripe(p);
+        std::memcpy(m_buffer, p, size);
+        m_bufferSize = size;
+    }
+
+    [[nodiscard]] uint64_t digest() const {
+        uint64_t h;
+        if (m_total >= 32) {
+            h = rotl(m_v[0], 1) + rotl(m_v[1], 7) + rotl(m_v[2], 12) + rotl(m_v[3], 18);
+            for (const uint64_t v : m_v) h = (h ^ round(0, v)) * kP1 + kP4;
+        } else {
+            h = m_seed + kP5;
+        }
+        h += m_total;
+
+        const unsigned char* p = m_buffer;
+        size_t left = m_bufferSize;
+        for (; left >= 8; p += 8, left -= 8) h = rotl(h ^ round(0, read64(p)), 27) * kP1 + kP4;
+        if (left >= 4) {
+            h = rotl(h ^ (read32(p) * kP1), 23) * kP2 + kP3;
+            p += 4;
+            left -= 4;
+        }
+        for (; left > 0; ++p, --left) h = rotl(h ^ (*p * kP5), 11) * kP1;
+
+        h ^= h >> 33;
+        h *= kP2;
+        h ^= h >> 29;
+        h *= kP3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    [[nodiscard]] static uint64_t of(const std::string_view data, const uint64_t seed = 0) {
+        Xxh64 h(seed);
+        h.update(data.data(), data.size());
+        return h.digest();
+    }
+
+private:
+    static constexpr uint64_t kP1 = 0x9E3779B185EBCA87ULL;
+    static constexpr uint64_t kP2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr uint64_t kP3 = 0x165667B19E3779F9ULL;
+    static constexpr uint64_t kP4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr uint64_t kP5 = 0x27D4EB2F165667C5ULL;
+
+    static uint64_t rotl(const uint64_t x, const int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t round(uint64_t acc, const uint64_t input) { return rotl(acc + input * kP2, 31) * kP1; }
+    static uint64_t read64(const unsigned char* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+    static uint64_t read32(const unsigned char* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+    void stripe(const unsigned char* p) {
+        for (int i = 0; i < 4; ++i) m_v[i] = round(m_v[i], read64(p + 8 * i));
+    }
+
+    uint64_t m_v[4]{};
+    uint64_t m_seed = 0;
+    uint64_t m_total = 0;
+    unsigned char m_buffer[32]{};
+    size_t m_bufferSize = 0;
+};
+
+// Hashes everything readable from fd (from its current offset). False on a read error.
+inline bool hash_fd(const int fd, uint64_t& out) {
+    static constexpr size_t kBufSize = 256 * 1024;
+    thread_local std::unique_ptr<char[]> buf(new char[kBufSize]);
+    Xxh64 h;
+    while (true) {
+        const ssize_t n = read(fd, buf.get(), kBufSize);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) break;
+        h.update(buf.get(), static_cast<size_t>(n));
+    }
+    out = h.digest();
+    return true;
+}
+
+inline std::string hash_hex(const uint64_t hash) {
+    return fmt::format("{:016x}", hash);
+}
@@ -1,9 +1,12 @@
 #pragma once
 #include <iostream>
+#include "print.hpp"
 
 namespace input {
     // Helper to get user input safely
     inline std::string getInput() {
+        // The question was logged; with LOG_ASYNC it must be on screen before we block
+        print::flush();
         std::string input;
         std::getline(std::cin, input);
         if (std::cin.eof()) {
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <csignal>
+#include <list>
+#include <string>
+#include <vector>
+#include <sys/syscall.h>
+
+#include "execute.hpp"
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+// Runs batches of external commands concurrently with a bounded number in flight.
+// A single thread multiplexes every child's stdout/stderr pipes and its pidfd with
+// poll, so children are reaped the moment they exit without a SIGCHLD handler.
+// ExecOptions apply to every job; output callbacks see the jobs' output interleaved.
+class JobPool {
+public:
+    using Command = std::vector<std::string>;
+    using Completion = std::function<void(size_t index, const CommandResult& result)>;
+
+    explicit JobPool(const unsigned parallelism = 0)
+        : m_parallelism(parallelism ? parallelism : std::max(1u, std::thread::hardware_concurrency())) {}
+
+    [[nodiscard]] unsigned parallelism() const { return m_parallelism; }
+
+    // Runs all commands and returns their results in input order.
+    std::vector<CommandResult> run(const std::vector<Command>& commands, const ExecOptions& options = {}) {
+        std::vector<CommandResult> results(commands.size());
+        run(commands, [&results](const size_t index, const CommandResult& result) {
+            results[index] = result;
+        }, options);
+        return results;
+    }
+
+    // Runs all commands, reporting each result as soon as its command has finished.
+    void run(const std::vector<Command>& commands, const Completion& on_complete, const ExecOptions& options = {}) {
+        std::list<Job> running;
+        size_t next = 0;
+        std::vector<pollfd> fds;
+        std::vector<std::pair<Job*, int>> owners; // (job, 0/1 pipe or 2 pidfd) per pollfd
+        char buf[64 * 1024];
+
+        while (next < commands.size() || !running.empty()) {
+            while (next < commands.size() && running.size() < m_parallelism) {
+                running.emplace_back(next, options);
+                if (!running.back().start(commands[next])) {
+                    on_complete(next, running.back().result);
+                    running.pop_back();
+                }
+                ++next;
+            }
+
+            fds.clear();
+            owners.clear();
+            bool needs_polling_reap = false;
+            for (auto& job : running) {
+                for (int i = 0; i < 2; ++i) {
+                    if (job.pumps[i].fd() >= 0) {
+                        fds.push_back({job.pumps[i].fd(), POLLIN, 0});
+                        owners.emplace_back(&job, i);
+                    }
+                }
+                if (!job.exited) {
+                    if (job.pidfd >= 0) {
+                        fds.push_back({job.pidfd, POLLIN, 0});
+                        owners.emplace_back(&job, 2);
+                    } else {
+                        needs_polling_reap = true;
+                    }
+                }
+            }
+
+            // Without pidfd support a finished child is only noticed by WNOHANG polling
+            if (!fds.empty() || needs_polling_reap) {
+                if (poll(fds.data(), fds.size(), needs_polling_reap ? 10 : -1) < 0 && errno != EINTR) {
+                    abandon(running, commands.size(), next, on_complete, errno);
+                    return;
+                }
+            }
+            for (size_t i = 0; i < fds.size(); ++i) {
+                if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+                auto [job, which] = owners[i];
+                if (which < 2) {
+                    job->pumps[which].drain(buf, sizeof(buf));
+                } else {
+                    job->reap(WNOHANG);
+                }
+            }
+
+            for (auto it = running.begin(); it != running.end();) {
+                if (it->pidfd < 0 && !it->exited) it->reap(WNOHANG);
+                if (it->exited && it->pumps[0].fd() < 0 && it->pumps[1].fd() < 0) {
+                    on_complete(it->index, it->result);
+                    it = running.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+private:
+    struct Job;
+
+    // The children can no longer be watched: kill the running ones and report every job
+    // that has not finished, started or not, as failed with err.
+    static void abandon(std::list<Job>& running, const size_t count, size_t next, const Completion& on_complete,
+                        const int err) {
+        const std::string reason = fmt::format("poll: {}", std::strerror(err));
+        for (auto& job : running) {
+            job.kill();
+            job.result.exit_code = -1;
+            job.result.stderr_output += reason;
+            on_complete(job.index, job.result);
+        }
+        running.clear();
+        for (; next < count; ++next) on_complete(next, CommandResult{-1, "", reason});
+    }
+
+    struct Job {
+        Job(const size_t idx, const ExecOptions& options)
+            : index(idx), result{-1, "", ""},
+              pumps{{-1, options.on_stdout, result.stdout_output, options},
+                    {-1, options.on_stderr, result.stderr_output, options}},
+              m_env(options.env) {}
+
+        Job(const Job&) = delete;
+        Job& operator=(const Job&) = delete;
+
+        ~Job() {
+            pumps[0].finish();
+            pumps[1].finish();
+            if (pidfd >= 0) close(pidfd);
+            if (!exited && pid > 0) reap(0);
+        }
+
+        // Spawns the command; on failure result holds a shell-style error.
+        bool start(const Command& args) {
+            int out[2], err[2];
+            if (pipe2(out, O_CLOEXEC) != 0) return fail(errno);
+            if (pipe2(err, O_CLOEXEC) != 0) {
+                close(out[0]); close(out[1]);
+                return fail(errno);
+            }
+            const int spawn_error = spawn_process(args, out[1], err[1], pid, m_env);
+            close(out[1]);
+            close(err[1]);
+            pumps[0].attach(out[0]);
+            pumps[1].attach(err[0]);
+            if (spawn_error != 0) {
+                pid = -1;
+                exited = true;
+                result.stderr_output = fmt::format("{}: {}", args.empty() ? "" : args[0], std::strerror(spawn_error));
+                result.exit_code = spawn_error == ENOENT ? 127 : 126;
+                return false;
+            }
+            pidfd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+            return true;
+        }
+
+        void kill() {
+            if (exited || pid <= 0) return;
+            ::kill(pid, SIGKILL);
+            reap(0);
+        }
+
+        void reap(const int flags) {
+            int status = 0;
+            pid_t r;
+            while ((r = waitpid(pid, &status, flags)) < 0 && errno == EINTR) {}
+            if (r == pid) {
+                exited = true;
+                result.exit_code = detail::decode_status(status);
+            } else if (r < 0) {
+                exited = true; // Already reaped elsewhere; nothing left to wait for
+            }
+        }
+
+        bool fail(const int err) {
+            exited = true;
+            result.stderr_output = std::strerror(err);
+            return false;
+        }
+
+        size_t index;
+        CommandResult result;
+        detail::OutputPump pumps[2];
+        pid_t pid = -1;
+        int pidfd = -1;
+        bool exited = false;
+
+    private:
+        const std::vector<std::string>& m_env;
+    };
+
+    unsigned m_parallelism;
+};
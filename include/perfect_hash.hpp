@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+// A perfect hash table over a fixed set of distinct strings (hash and displace, as in
+// CHD). Keys are split into small buckets by one hash; each bucket then gets a seed that
+// sends all of its keys to free slots. A lookup is one pass over the key, a multiply and
+// one comparison, with no probing, whatever the key set.
+//
+// The table stores views: the keys must outlive it.
+class PerfectHash {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    PerfectHash() = default;
+
+    explicit PerfectHash(std::vector<std::string_view> keys) : m_keys(std::move(keys)) {
+        if (m_keys.empty()) return;
+        for (const auto& key : m_keys) {
+            m_minSize = std::min(m_minSize, key.size());
+            m_maxSize = std::max(m_maxSize, key.size());
+        }
+        // A fresh salt is only needed if two keys share a full 64-bit hash
+        for (uint64_t salt = 0; salt < 8; ++salt) {
+            if (build(salt)) return;
+        }
+        throw std::runtime_error("cannot build a perfect hash for this key set");
+    }
+
+    // Index of key in the constructor's list, or npos when it isn't one of them.
+    [[nodiscard]] uint32_t find(const std::string_view key) const {
+        if (m_slots.empty() || key.size() < m_minSize || key.size() > m_maxSize) return npos;
+        const uint64_t h = hash(key, m_salt);
+        const uint32_t index = m_slots[slot(h, m_seeds[bucket(h)])];
+        if (index == npos) return npos;
+        const std::string_view candidate = m_keys[index];
+        return candidate.size() == key.size() && std::memcmp(candidate.data(), key.data(), key.size()) == 0 ? index : npos;
+    }
+
+    [[nodiscard]] size_t size() const { return m_keys.size(); }
+
+private:
+    // Keys per bucket on average; smaller buckets find seeds faster but cost more seeds
+    static constexpr size_t kBucketLoad = 4;
+
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    // Identifiers are short: eight bytes per multiply-mix round is plenty
+    static uint64_t hash(const std::string_view key, const uint64_t salt) {
+        uint64_t h = salt ^ (key.size() * 0x9e3779b97f4a7c15ULL);
+        size_t i = 0;
+        for (; i + 8 <= key.size(); i += 8) {
+            uint64_t word;
+            std::memcpy(&word, key.data() + i, 8);
+            h = mix(h ^ word);
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, key.data() + i, key.size() - i);
+        return mix(h ^ tail);
+    }
+
+    [[nodiscard]] uint32_t bucket(const uint64_t h) const {
+        return static_cast<uint32_t>(((h >> 32) * m_seeds.size()) >> 32);
+    }
+
+    [[nodiscard]] size_t slot(const uint64_t h, const uint32_t seed) const {
+        return mix(h + seed) & (m_slots.size() - 1);
+    }
+
+    bool build(const uint64_t salt) {
+        m_salt = salt;
+        m_seeds.assign((m_keys.size() + kBucketLoad - 1) / kBucketLoad, 0);
+        // At least 25% spare slots keeps the seed search short for the last buckets
+        size_t slots = 1;
+        while (slots < m_keys.size() + m_keys.size() / 4 + 1) slots <<= 1;
+        m_slots.assign(slots, npos);
+
+        std::vector<uint64_t> hashes(m_keys.size());
+        std::vector<std::vector<uint32_t>> buckets(m_seeds.size());
+        for (uint32_t i = 0; i < m_keys.size(); ++i) {
+            hashes[i] = hash(m_keys[i], salt);
+            buckets[bucket(hashes[i])].push_back(i);
+        }
+        // Largest buckets first, while the table is still empty
+        std::vector<uint32_t> order(buckets.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::stable_sort(order, [&](const uint32_t a, const uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+        std::vector<size_t> taken;
+        for (const uint32_t b : order) {
+            if (buckets[b].empty()) break;
+            bool placed = false;
+            for (uint32_t seed = 1; seed < (1u << 20) && !placed; ++seed) {
+                taken.clear();
+                placed = true;
+                for (const uint32_t key : buckets[b]) {
+                    const size_t s = slot(hashes[key], seed);
+                    if (m_slots[s] != npos || std::ranges::find(taken, s) != taken.end()) {
+                        placed = false;
+                        break;
+                    }
+                    taken.push_back(s);
+                }
+                if (placed) {
+                    m_seeds[b] = seed;
+                    for (size_t k = 0; k < taken.size(); ++k) m_slots[taken[k]] = buckets[b][k];
+                }
+            }
+            if (!placed) return false;
+        }
+        return true;
+    }
+
+    std::vector<std::string_view> m_keys;
+    std::vector<uint32_t> m_seeds; // Per bucket
+    std::vector<uint32_t> m_slots; // Key index, or npos
+    uint64_t m_salt = 0;
+    size_t m_minSize = SIZE_MAX;
+    size_t m_maxSize = 0;
+};
@@ -4,10 +4,12 @@
 
 #include <fmt/core.h>
 #include <fmt/color.h>
+#include <atomic>
+#include <cstdint>
 #include <mutex>
-#include <chrono>
 #include <ctime>
-#include <sstream>
+#include <string>
+#include <string_view>
 
 // ====== CONFIGURATION: Compile-time flags ======
 // Define these in CMake or via compiler flags (-DLOG_DISABLE, etc.)
@@ -17,6 +19,16 @@
 // #define LOG_DISABLE
 #endif
 
+// Lowest level compiled in: 0 trace, 1 debug, 2 info, 3 warn, 4 error, 5 nothing.
+// Calls below it are removed entirely; the rest are filtered at runtime (print::set_level).
+#ifndef LOG_MIN_LEVEL
+    #ifdef LOG_DISABLE
+        #define LOG_MIN_LEVEL 5
+    #else
+        #define LOG_MIN_LEVEL 0
+    #endif
+#endif
+
 // Disable specific levels (useful for stripping verbose logs)
 #ifndef LOG_DISABLE_INFO
 // #define LOG_DISABLE_INFO
@@ -43,6 +55,11 @@
 // #define LOG_DISABLE_TIMESTAMP
 #endif
 
+// Queue lines for a background writer instead of writing them in the caller (see async_log.hpp)
+#ifndef LOG_ASYNC
+// #define LOG_ASYNC
+#endif
+
 // Enable thread-safe output
 #ifndef LOG_DISABLE_THREAD_SAFETY
     #define LOG_THREAD_SAFE
@@ -60,8 +77,13 @@
 
 // ===============================================
 
-// Forward declare file sink if enabled
-#ifdef LOG_ENABLE_FILE
+#include "binlog.hpp"
+#ifdef LOG_ASYNC
+#include "async_log.hpp"
+#endif
+
+// Forward declare file sink if enabled (the async backend has its own, print::open_log_file)
+#if defined(LOG_ENABLE_FILE) && !defined(LOG_ASYNC)
 #include <fstream>
 extern std::ofstream g_log_file;
 void init_log_file(const std::string& filename);
@@ -76,32 +98,55 @@ void close_log_file();
     #define LOG_LOCK()
 #endif
 
-// Helper to format timestamp: YYYY-MM-DD HH:MM:SS.mmm
-inline std::string now_str() {
+// Timestamp for log lines: YYYY-MM-DD HH:MM:SS.mmm
+// Each thread caches the date and time text and reformats it only when the second
+// changes; otherwise just the milliseconds are patched in. The coarse clock is a vDSO
+// read with tick (1-4 ms) resolution, which is plenty for log lines.
+inline std::string_view log_timestamp() {
 #ifdef LOG_DISABLE_TIMESTAMP
     return "YYYY-MM-DD HH:MM:SS.000"; // placeholder
 #else
-    const auto now = std::chrono::system_clock::now();
-    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    const auto time_t = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    ss << '.' << std::setfill('0') << std::setw(3) << ms.count();
-    return ss.str();
+    struct Cache {
+        time_t second = -1;
+        char text[24] = "YYYY-MM-DD HH:MM:SS.000";
+    };
+    thread_local Cache cache;
+
+    timespec now{};
+    clock_gettime(CLOCK_REALTIME_COARSE, &now);
+    if (now.tv_sec != cache.second) {
+        tm local{};
+        localtime_r(&now.tv_sec, &local);
+        strftime(cache.text, sizeof(cache.text), "%Y-%m-%d %H:%M:%S", &local);
+        cache.text[19] = '.';
+        cache.second = now.tv_sec;
+    }
+    const auto ms = static_cast<unsigned>(now.tv_nsec / 1000000);
+    cache.text[20] = static_cast<char>('0' + ms / 100);
+    cache.text[21] = static_cast<char>('0' + ms / 10 % 10);
+    cache.text[22] = static_cast<char>('0' + ms % 10);
+    return {cache.text, 23};
 #endif
 }
 
+inline std::string now_str() {
+    return std::string(log_timestamp());
+}
+
 // Color definitions (conditionally disabled)
 #ifdef LOG_DISABLE_COLORS
-    #define COLOR_INFO
-    #define COLOR_WARN
-    #define COLOR_ERROR
-    #define COLOR_SUCCESS
-    #define COLOR_CMD
-    #define COLOR_PROMPT
-    #define COLOR_DEFAULT
+    #define COLOR_TRACE fmt::text_style()
+    #define COLOR_DEBUG fmt::text_style()
+    #define COLOR_INFO fmt::text_style()
+    #define COLOR_WARN fmt::text_style()
+    #define COLOR_ERROR fmt::text_style()
+    #define COLOR_SUCCESS fmt::text_style()
+    #define COLOR_CMD fmt::text_style()
+    #define COLOR_PROMPT fmt::text_style()
+    #define COLOR_DEFAULT fmt::text_style()
 #else
+    #define COLOR_TRACE fmt::fg(fmt::color::gray)
+    #define COLOR_DEBUG fmt::fg(fmt::color::medium_purple)
     #define COLOR_INFO fmt::fg(fmt::color::dodger_blue) | fmt::emphasis::bold
     #define COLOR_WARN fmt::fg(fmt::color::orange) | fmt::emphasis::bold
     #define COLOR_ERROR fmt::fg(fmt::color::crimson) | fmt::emphasis::bold
@@ -113,71 +158,162 @@ inline std::string now_str() {
 
 namespace print {
 
+    enum class Level : uint8_t { Trace, Debug, Info, Warn, Error, Off };
+
+    inline constexpr Level kMinLevel = static_cast<Level>(LOG_MIN_LEVEL);
+
+    namespace detail {
+        inline std::atomic<Level> g_level{Level::Info};
+    }
+
+    // Whether calls at level survive compilation at all
+    constexpr bool compiled_in(const Level level) { return level >= kMinLevel && level != Level::Off; }
+
+    // The runtime check every log call makes before formatting anything
+    inline bool enabled(const Level level) {
+        return compiled_in(level) && level >= detail::g_level.load(std::memory_order_relaxed);
+    }
+
+    inline void set_level(const Level level) { detail::g_level.store(level, std::memory_order_relaxed); }
+    inline Level level() { return detail::g_level.load(std::memory_order_relaxed); }
+
+    // Accepts trace, debug, info, warn, error and off. False (level untouched) otherwise.
+    inline bool parse_level(const std::string_view name, Level& level) {
+        static constexpr std::pair<std::string_view, Level> names[] = {
+            {"trace", Level::Trace}, {"debug", Level::Debug}, {"info", Level::Info},
+            {"warn", Level::Warn}, {"error", Level::Error}, {"off", Level::Off},
+        };
+        for (const auto& [n, l] : names) {
+            if (n == name) {
+                level = l;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Waits until everything logged so far (text and binary) has been written.
+    inline void flush() {
+        binlog::flush();
+#ifdef LOG_ASYNC
+        detail::AsyncLog::instance().flush();
+#else
+        LOG_LOCK();
+        fflush(LOG_DEFAULT_STREAM);
+        fflush(LOG_ERROR_STREAM);
+#endif
+    }
+
     // Generic log function with stream and color
     template<typename... T>
     void log_impl(const fmt::text_style style, FILE* stream, const char* level, fmt::format_string<T...> fmt, T&&... args) {
-        LOG_LOCK();
-        std::string time_str = now_str();
+        const std::string_view time_str = log_timestamp();
 
-        // Format the message
-        auto msg = fmt::format(fmt, std::forward<T>(args)...);
+        // Format the whole line up front; the sinks only ever see complete lines
+        fmt::memory_buffer line;
+#ifdef LOG_DISABLE_COLORS
+        (void)style;
+        fmt::format_to(std::back_inserter(line), "[{}] [{}] ", time_str, level);
+#else
+        fmt::format_to(std::back_inserter(line), style, "[{}] [{}] ", time_str, level); // Avoid color reset interference
+#endif
+        const size_t msg_start = line.size();
+        fmt::format_to(std::back_inserter(line), fmt, std::forward<T>(args)...);
+        line.push_back('\n');
+        const std::string_view term(line.data(), line.size());
+        [[maybe_unused]] const std::string_view msg = term.substr(msg_start);
 
-        // Output with or without color
+#ifdef LOG_ASYNC
+        auto& backend = detail::AsyncLog::instance();
+        fmt::memory_buffer plain;
+        std::string_view file_line;
+        if (backend.wantsFile()) {
 #ifdef LOG_DISABLE_COLORS
-        fmt::print(stream, "[{}] [{}] {}", time_str, level, msg);
+            file_line = term;
 #else
-        fmt::print(stream, style, "[{}] [{}] ", time_str, level);
-        fmt::print(stream, "{}", msg); // Avoid color reset interference
+            fmt::format_to(std::back_inserter(plain), "[{}] [{}] {}", time_str, level, msg);
+            file_line = std::string_view(plain.data(), plain.size());
 #endif
-        fmt::print(stream, "\n");
+        }
+        backend.submit(fileno(stream), term, file_line);
+#else
+        LOG_LOCK();
+        fwrite(term.data(), 1, term.size(), stream);
 
 #ifdef LOG_ENABLE_FILE
         // Also write to file (without color codes)
-        g_log_file << "[" << time_str << "] [" << level << "] " << msg << "\n";
+        g_log_file << "[" << time_str << "] [" << level << "] " << msg;
         g_log_file.flush();
 #endif
+#endif
+    }
+
+    // Level filter and sink selection shared by the log functions. With a binary log
+    // open, every enabled record goes there; trace and debug records go only there.
+    template<Level L, typename... T>
+    void log_at(const fmt::text_style style, FILE* stream, const char* tag, fmt::format_string<T...> fmt, T&&... args) {
+        if constexpr (compiled_in(L)) {
+            if (!enabled(L)) return;
+            if (binlog::active()) {
+                const fmt::string_view text = fmt;
+                binlog::record(static_cast<uint8_t>(L), std::string_view(text.data(), text.size()), args...);
+                if constexpr (L < Level::Info) return;
+            }
+            log_impl(style, stream, tag, fmt, std::forward<T>(args)...);
+        }
     }
 
     // Individual log functions (conditionally compiled)
 
+    template<typename... T>
+    void trace(fmt::format_string<T...> fmt, T&&... args) {
+        log_at<Level::Trace>(COLOR_TRACE, LOG_DEFAULT_STREAM, "[TRACE]", fmt, std::forward<T>(args)...);
+    }
+
+    template<typename... T>
+    void debug(fmt::format_string<T...> fmt, T&&... args) {
+        log_at<Level::Debug>(COLOR_DEBUG, LOG_DEFAULT_STREAM, "[DEBUG]", fmt, std::forward<T>(args)...);
+    }
+
 #ifndef LOG_DISABLE_INFO
     template<typename... T>
     void info(fmt::format_string<T...> fmt, T&&... args) {
-        log_impl(COLOR_INFO, LOG_DEFAULT_STREAM, "[INFO]", fmt, std::forward<T>(args)...);
+        log_at<Level::Info>(COLOR_INFO, LOG_DEFAULT_STREAM, "[INFO]", fmt, std::forward<T>(args)...);
     }
 #endif
 
     template<typename... T>
     void warn(fmt::format_string<T...> fmt, T&&... args) {
 #ifndef LOG_DISABLE_WARN
-        log_impl(COLOR_WARN, LOG_ERROR_STREAM, "[WARNING]", fmt, std::forward<T>(args)...);
+        log_at<Level::Warn>(COLOR_WARN, LOG_ERROR_STREAM, "[WARNING]", fmt, std::forward<T>(args)...);
 #endif
     }
 
     template<typename... T>
     void error(fmt::format_string<T...> fmt, T&&... args) {
 #ifndef LOG_DISABLE_ERROR
-        log_impl(COLOR_ERROR, LOG_ERROR_STREAM, "[ERROR]", fmt, std::forward<T>(args)...);
+        log_at<Level::Error>(COLOR_ERROR, LOG_ERROR_STREAM, "[ERROR]", fmt, std::forward<T>(args)...);
 #endif
     }
 
     template<typename... T>
     void success(fmt::format_string<T...> fmt, T&&... args) {
 #ifndef LOG_DISABLE_INFO
-        log_impl(COLOR_SUCCESS, LOG_DEFAULT_STREAM, "[OK]", fmt, std::forward<T>(args)...);
+        log_at<Level::Info>(COLOR_SUCCESS, LOG_DEFAULT_STREAM, "[OK]", fmt, std::forward<T>(args)...);
 #endif
     }
 
     template<typename... T>
     void command(fmt::format_string<T...> fmt, T&&... args) {
 #ifndef LOG_DISABLE_INFO
-        log_impl(COLOR_CMD, LOG_DEFAULT_STREAM, "[CMD]", fmt, std::forward<T>(args)...);
+        log_at<Level::Info>(COLOR_CMD, LOG_DEFAULT_STREAM, "[CMD]", fmt, std::forward<T>(args)...);
 #endif
     }
 
     // Optional prompt utility (e.g., for interactive tools)
     template<typename... T>
     void prompt(fmt::format_string<T...> fmt, T&&... args) {
+        flush();
         LOG_LOCK();
 #ifdef LOG_DISABLE_COLORS
         fmt::print(stdout, "[PROMPT] ");
@@ -189,4 +325,11 @@ namespace print {
         fflush(stdout);
     }
 
-} // namespace out
\ No newline at end of file
+} // namespace print
+
+// For hot paths: skips evaluating the arguments too when the level is filtered out,
+// and compiles to nothing below LOG_MIN_LEVEL.
+#define LOG_TRACE(...) do { if constexpr (print::compiled_in(print::Level::Trace)) { \
+    if (print::enabled(print::Level::Trace)) print::trace(__VA_ARGS__); } } while (0)
+#define LOG_DEBUG(...) do { if constexpr (print::compiled_in(print::Level::Debug)) { \
+    if (print::enabled(print::Level::Debug)) print::debug(__VA_ARGS__); } } while (0)
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Scoped timers and counters behind `dvk --profile` and `--trace-out <file>`.
+//
+// Work is attributed to a fixed set of phases. A ScopedTimer adds its wall and thread
+// CPU time to its phase; count() adds the syscalls and bytes the instrumented code
+// issued. Totals are summed across threads, so a parallel phase can exceed the
+// command's wall time. With tracing on, every timed scope is also kept as a Chrome
+// trace event (chrome://tracing, Perfetto).
+//
+// Disabled, each timer or counter costs one relaxed load and branch. Enabled, a timed
+// scope costs a few clock reads (~0.5us), which is noticeable on per-file scopes.
+
+namespace profile {
+
+    enum class Phase : uint8_t { Walk, Match, Copy, Compress, Spawn, Verify, None };
+
+    inline constexpr size_t kPhases = static_cast<size_t>(Phase::None);
+    inline constexpr const char* kPhaseNames[kPhases] = {"walk", "match", "copy", "compress", "spawn", "verify"};
+
+namespace detail {
+
+    struct alignas(64) Totals {
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> wall_ns{0};
+        std::atomic<uint64_t> cpu_ns{0};
+        std::atomic<uint64_t> syscalls{0};
+        std::atomic<uint64_t> bytes{0};
+    };
+
+    struct Event {
+        const char* name;
+        Phase phase;
+        uint64_t start_ns;
+        uint64_t duration_ns;
+    };
+
+    struct ThreadEvents {
+        int tid = static_cast<int>(syscall(SYS_gettid));
+        std::vector<Event> events;
+    };
+
+    // Beyond this the trace stops growing (and says so) rather than eating memory
+    inline constexpr size_t kMaxEvents = 2'000'000;
+
+    inline std::atomic<bool> g_enabled{false};
+    inline std::atomic<bool> g_tracing{false};
+    inline Totals g_totals[kPhases];
+    inline std::atomic<size_t> g_eventCount{0};
+    inline std::mutex g_threadsMutex;
+    inline std::vector<std::shared_ptr<ThreadEvents>> g_threads; // Kept after their thread exits
+
+    inline uint64_t clockNs(const clockid_t clock) {
+        timespec ts{};
+        clock_gettime(clock, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    inline ThreadEvents& threadEvents() {
+        thread_local std::shared_ptr<ThreadEvents> events = [] {
+            auto created = std::make_shared<ThreadEvents>();
+            std::lock_guard lock(g_threadsMutex);
+            g_threads.push_back(created);
+            return created;
+        }();
+        return *events;
+    }
+
+} // namespace detail
+
+    [[nodiscard]] inline bool enabled() { return detail::g_enabled.load(std::memory_order_relaxed); }
+
+    // Starts collecting; with trace, timed scopes are also kept as trace events.
+    inline void enable(const bool trace) {
+        detail::g_tracing.store(trace, std::memory_order_relaxed);
+        detail::g_enabled.store(true, std::memory_order_relaxed);
+    }
+
+    inline void count(const Phase phase, const uint64_t syscalls, const uint64_t bytes = 0) {
+        if (!enabled() || phase == Phase::None) return;
+        auto& totals = detail::g_totals[static_cast<size_t>(phase)];
+        totals.syscalls.fetch_add(syscalls, std::memory_order_relaxed);
+        if (bytes) totals.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // Times the enclosing scope. Phase::None scopes only appear in the trace, under name.
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(const Phase phase, const char* name = nullptr) : m_phase(phase), m_name(name) {
+            if (!enabled()) return;
+            m_active = true;
+            m_cpu = detail::clockNs(CLOCK_THREAD_CPUTIME_ID);
+            m_start = detail::clockNs(CLOCK_MONOTONIC);
+        }
+
+        ~ScopedTimer() {
+            if (!m_active) return;
+            const uint64_t wall = detail::clockNs(CLOCK_MONOTONIC) - m_start;
+            if (m_phase != Phase::None) {
+                auto& totals = detail::g_totals[static_cast<size_t>(m_phase)];
+                totals.calls.fetch_add(1, std::memory_order_relaxed);
+                totals.wall_ns.fetch_add(wall, std::memory_order_relaxed);
+                totals.cpu_ns.fetch_add(detail::clockNs(CLOCK_THREAD_CPUTIME_ID) - m_cpu, std::memory_order_relaxed);
+            }
+            if (detail::g_tracing.load(std::memory_order_relaxed) &&
+                detail::g_eventCount.fetch_add(1, std::memory_order_relaxed) < detail::kMaxEvents) {
+                const char* name = m_name ? m_name : m_phase == Phase::None ? "scope" : kPhaseNames[static_cast<size_t>(m_phase)];
+                detail::threadEvents().events.push_back({name, m_phase, m_start, wall});
+            }
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        Phase m_phase;
+        const char* m_name;
+        bool m_active = false;
+        uint64_t m_start = 0;
+        uint64_t m_cpu = 0;
+    };
+
+    // Logs the per-phase table. total_wall_ns is the command's own wall time.
+    void report(uint64_t total_wall_ns);
+
+    // Writes the collected events as Chrome trace-event JSON. False on I/O failure.
+    bool write_trace(const std::string& path);
+
+} // namespace profile
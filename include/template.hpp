@@ -0,0 +1,161 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Text templates with named placeholders ("_PROJECT_NAME_"), parsed once and rendered
+// in one pass.
+//
+// A Template splits its text into literal and placeholder segments when it is built,
+// which can happen at compile time: declare it constexpr over a string literal and a
+// template that outgrows MaxSegments fails to compile. Templates parsed from text only
+// known at run time (packed templates, user overrides) take MaxSegments = kDynamic and
+// keep their segments in a vector instead. render() then sizes the output
+// once from the literal length and the values, and appends each segment in order, so
+// rendering is linear in the output however many placeholders there are.
+//
+// Placeholder names are matched literally wherever they occur; pick names that cannot
+// appear in the surrounding text.
+
+namespace tmpl {
+
+    template<size_t Slots>
+    using Names = std::array<std::string_view, Slots>;
+
+    // Values for a template's placeholders, in the order of its names
+    template<size_t Slots>
+    using Values = std::array<std::string_view, Slots>;
+
+namespace detail {
+
+    // Index of the placeholder starting at text[pos], or -1
+    template<size_t Slots>
+    constexpr int placeholderAt(const std::string_view text, const size_t pos, const Names<Slots>& names) {
+        for (size_t i = 0; i < Slots; ++i) {
+            if (!names[i].empty() && text.substr(pos, names[i].size()) == names[i]) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    // Calls on_literal(text) and on_slot(index) for each segment of text, in order
+    template<size_t Slots, typename L, typename P>
+    constexpr void split(const std::string_view text, const Names<Slots>& names, L&& on_literal, P&& on_slot) {
+        // Only positions holding the first character of some name can start a placeholder
+        char firsts[Slots + 1] = {};
+        size_t count = 0;
+        for (const auto& name : names) {
+            if (!name.empty() && std::string_view(firsts, count).find(name[0]) == std::string_view::npos) {
+                firsts[count++] = name[0];
+            }
+        }
+        const std::string_view starts(firsts, count);
+
+        size_t literal = 0;
+        for (size_t pos = text.find_first_of(starts); pos < text.size(); pos = text.find_first_of(starts, pos)) {
+            const int slot = placeholderAt(text, pos, names);
+            if (slot < 0) {
+                ++pos;
+                continue;
+            }
+            if (pos > literal) on_literal(text.substr(literal, pos - literal));
+            on_slot(slot);
+            pos += names[static_cast<size_t>(slot)].size();
+            literal = pos;
+        }
+        if (literal < text.size()) on_literal(text.substr(literal));
+    }
+
+} // namespace detail
+
+    // MaxSegments for a template of any length, stored on the heap
+    inline constexpr size_t kDynamic = 0;
+
+    template<size_t Slots, size_t MaxSegments = 32>
+    class Template {
+    public:
+        // text must outlive the template; string literals do.
+        constexpr Template(const std::string_view text, const Names<Slots>& names) {
+            detail::split(text, names,
+                [this](const std::string_view literal) {
+                    push({literal, -1});
+                    m_literalSize += literal.size();
+                },
+                [this](const int slot) {
+                    push({{}, slot});
+                    ++m_uses[static_cast<size_t>(slot)];
+                });
+        }
+
+        // Output size for the given values
+        [[nodiscard]] constexpr size_t size(const Values<Slots>& values) const {
+            size_t total = m_literalSize;
+            for (size_t i = 0; i < Slots; ++i) total += m_uses[i] * values[i].size();
+            return total;
+        }
+
+        void append_to(std::string& out, const Values<Slots>& values) const {
+            out.reserve(out.size() + size(values));
+            for (size_t i = 0; i < m_count; ++i) {
+                const Segment& s = m_segments[i];
+                out.append(s.slot < 0 ? s.text : values[static_cast<size_t>(s.slot)]);
+            }
+        }
+
+        [[nodiscard]] std::string render(const Values<Slots>& values) const {
+            std::string out;
+            append_to(out, values);
+            return out;
+        }
+
+    private:
+        struct Segment {
+            std::string_view text; // Literal text; empty for placeholders
+            int slot = -1;         // Placeholder index, or -1 for literal text
+        };
+
+        static constexpr bool kOnHeap = MaxSegments == kDynamic;
+
+        constexpr void push(const Segment segment) {
+            if constexpr (kOnHeap) {
+                m_segments.push_back(segment);
+                ++m_count;
+            } else {
+                if (m_count == MaxSegments) throw std::length_error("template has too many segments");
+                m_segments[m_count++] = segment;
+            }
+        }
+
+        std::conditional_t<kOnHeap, std::vector<Segment>, std::array<Segment, MaxSegments>> m_segments{};
+        size_t m_count = 0;
+        size_t m_literalSize = 0;
+        std::array<size_t, Slots> m_uses{};
+    };
+
+    // Renders text that is only known at run time, without keeping the parse: one pass
+    // to size the output and one to write it.
+    template<size_t Slots>
+    void append_to(std::string& out, const std::string_view text, const Names<Slots>& names, const Values<Slots>& values) {
+        size_t total = 0;
+        detail::split(text, names,
+            [&total](const std::string_view literal) { total += literal.size(); },
+            [&total, &values](const int slot) { total += values[static_cast<size_t>(slot)].size(); });
+        out.reserve(out.size() + total);
+        detail::split(text, names,
+            [&out](const std::string_view literal) { out.append(literal); },
+            [&out, &values](const int slot) { out.append(values[static_cast<size_t>(slot)]); });
+    }
+
+    template<size_t Slots>
+    [[nodiscard]] std::string render(const std::string_view text, const Names<Slots>& names, const Values<Slots>& values) {
+        std::string out;
+        append_to(out, text, names, values);
+        return out;
+    }
+
+} // namespace tmpl
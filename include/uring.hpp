@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// A minimal io_uring, driven through the raw syscalls so dvk doesn't depend on liburing.
+//
+// Usage: take SQEs with next(), fill them in, submit(wait) and drain completions with
+// reap(). One thread per ring: nothing here is synchronised.
+//
+// create() returns null when the kernel has no io_uring or it is blocked (seccomp,
+// io_uring_disabled). Callers keep a plain-syscall path for that case.
+
+class Uring {
+public:
+    static std::unique_ptr<Uring> create(const unsigned entries) {
+        io_uring_params params{};
+        const int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) return nullptr;
+        std::unique_ptr<Uring> ring(new Uring(fd));
+        if (!ring->map(params)) return nullptr;
+        return ring;
+    }
+
+    ~Uring() {
+        if (m_sqes) munmap(m_sqes, m_sqesSize);
+        if (m_cqMap && m_cqMap != m_sqMap) munmap(m_cqMap, m_cqMapSize);
+        if (m_sqMap) munmap(m_sqMap, m_sqMapSize);
+        close(m_fd);
+    }
+
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+    // A zeroed SQE to fill in, or null when the submission queue is full (submit first).
+    io_uring_sqe* next() {
+        const unsigned head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+        if (m_sqTail - head >= m_sqEntries) return nullptr;
+        const unsigned index = m_sqTail & m_sqMask;
+        io_uring_sqe* sqe = &m_sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        m_sqArray[index] = index;
+        ++m_sqTail;
+        ++m_pending;
+        return sqe;
+    }
+
+    // Submits the queued SQEs and waits for at least wait completions. Returns the
+    // number submitted, or -errno.
+    int submit(const unsigned wait = 0) {
+        __atomic_store_n(m_sqTailShared, m_sqTail, __ATOMIC_RELEASE);
+        const unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+        while (true) {
+            const long n = syscall(__NR_io_uring_enter, m_fd, m_pending, wait, flags, nullptr, 0);
+            if (n >= 0) {
+                m_pending -= static_cast<unsigned>(n);
+                return static_cast<int>(n);
+            }
+            if (errno != EINTR) return -errno;
+        }
+    }
+
+    // Calls on_cqe(user_data, res) for every completion already posted; returns how many.
+    template<typename F>
+    unsigned reap(F&& on_cqe) {
+        unsigned head = *m_cqHead;
+        const unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        unsigned seen = 0;
+        for (; head != tail; ++head, ++seen) {
+            const io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+            on_cqe(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+        return seen;
+    }
+
+    // Registers a table of count empty slots for direct descriptors (IOSQE_FIXED_FILE).
+    [[nodiscard]] bool registerFileSlots(const unsigned count) {
+        const std::unique_ptr<int[]> fds(new int[count]);
+        for (unsigned i = 0; i < count; ++i) fds[i] = -1;
+        if (syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_FILES, fds.get(), count) != 0) return false;
+        m_fileSlots = count;
+        return true;
+    }
+
+    [[nodiscard]] unsigned entries() const { return m_sqEntries; }
+    [[nodiscard]] unsigned fileSlots() const { return m_fileSlots; }
+
+    // The calling thread's ring, shared by every batch helper that runs on it, with at least
+    // entries SQEs and slots direct descriptor slots; a smaller one is replaced. Kept for the
+    // thread's lifetime. Null once io_uring or direct descriptors turned out to be
+    // unavailable on this thread, so the probe is paid once.
+    static Uring* forThread(const unsigned entries, const unsigned slots) {
+        ThreadRing& mine = threadRing();
+        if (mine.disabled) return nullptr;
+        if (mine.ring && mine.ring->entries() >= entries && mine.ring->fileSlots() >= slots) return mine.ring.get();
+        const unsigned want_entries = mine.ring ? std::max(entries, mine.ring->entries()) : entries;
+        const unsigned want_slots = mine.ring ? std::max(slots, mine.ring->fileSlots()) : slots;
+        mine.ring = create(want_entries);
+        if (!mine.ring || !mine.ring->registerFileSlots(want_slots)) {
+            mine.ring.reset();
+            mine.disabled = true;
+        }
+        return mine.ring.get();
+    }
+
+    // For callers that found the kernel won't open files into direct descriptors (before
+    // 5.15): forThread() returns null on this thread from now on.
+    static void disableForThread() {
+        ThreadRing& mine = threadRing();
+        mine.ring.reset();
+        mine.disabled = true;
+    }
+
+private:
+    struct ThreadRing {
+        std::unique_ptr<Uring> ring;
+        bool disabled = false;
+    };
+
+    static ThreadRing& threadRing() {
+        thread_local ThreadRing mine;
+        return mine;
+    }
+
+    explicit Uring(const int fd) : m_fd(fd) {}
+
+    bool map(const io_uring_params& p) {
+        m_sqMapSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        m_cqMapSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) m_sqMapSize = m_cqMapSize = std::max(m_sqMapSize, m_cqMapSize);
+
+        m_sqMap = mmap(nullptr, m_sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        if (m_sqMap == MAP_FAILED) return m_sqMap = nullptr, false;
+        m_cqMap = single ? m_sqMap
+                         : mmap(nullptr, m_cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        if (m_cqMap == MAP_FAILED) return m_cqMap = nullptr, false;
+        m_sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return false;
+        m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq = static_cast<char*>(m_sqMap);
+        auto* cq = static_cast<char*>(m_cqMap);
+        m_sqHead = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        m_sqTailShared = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        m_sqMask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        m_sqEntries = p.sq_entries;
+        m_sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        m_sqTail = *m_sqTailShared;
+        m_cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        m_cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        m_cqMask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        return true;
+    }
+
+    int m_fd;
+    void* m_sqMap = nullptr;
+    void* m_cqMap = nullptr;
+    size_t m_sqMapSize = 0;
+    size_t m_cqMapSize = 0;
+    size_t m_sqesSize = 0;
+    io_uring_sqe* m_sqes = nullptr;
+
+    unsigned* m_sqHead = nullptr;
+    unsigned* m_sqTailShared = nullptr;
+    unsigned* m_sqArray = nullptr;
+    unsigned m_sqMask = 0;
+    unsigned m_sqEntries = 0;
+    unsigned m_sqTail = 0;   // Local tail, published by submit()
+    unsigned m_pending = 0;  // Queued but not yet accepted by the kernel
+
+    unsigned* m_cqHead = nullptr;
+    unsigned* m_cqTail = nullptr;
+    unsigned m_cqMask = 0;
+    io_uring_cqe* m_cqes = nullptr;
+
+    unsigned m_fileSlots = 0; // Registered direct descriptor slots
+};
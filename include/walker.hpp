@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "profile.hpp"
+
+namespace fs = std::filesystem;
+
+// One directory entry as seen by a walk callback. dir_fd and the views are only
+// valid for the duration of the callback.
+struct WalkEntry {
+    int dir_fd;              // Parent directory, usable with the *at() calls
+    std::string_view name;   // Entry name, NUL-terminated
+    std::string_view parent; // Parent path relative to the walk root ("" for the root)
+    unsigned char type;      // DT_* value; DT_UNKNOWN is resolved with fstatat
+    unsigned worker;         // Index of the calling worker, for lock-free per-thread results
+
+    [[nodiscard]] bool is_dir() const { return type == DT_DIR; }
+    [[nodiscard]] bool is_file() const { return type == DT_REG; }
+    [[nodiscard]] bool is_symlink() const { return type == DT_LNK; }
+
+    // Path relative to the walk root
+    [[nodiscard]] std::string rel_path() const {
+        if (parent.empty()) return std::string(name);
+        std::string path;
+        path.reserve(parent.size() + 1 + name.size());
+        path.append(parent).append(1, '/').append(name);
+        return path;
+    }
+};
+
+struct WalkOptions {
+    unsigned threads = 0; // 0 = one worker per hardware thread
+    // Called when a directory cannot be opened or read: (relative path, errno)
+    std::function<void(const std::string&, int)> on_error;
+};
+
+// Visitor for every entry below the root, called concurrently from all workers.
+// Returning false for a directory prunes it before it is opened.
+using WalkVisitor = std::function<bool(const WalkEntry&)>;
+
+// Multi-threaded directory walker built on openat/getdents64. Every worker owns a
+// deque of pending directories; it works depth-first from the back of its own
+// deque and steals from the front of the others when it runs dry.
+class DirWalker {
+public:
+    explicit DirWalker(WalkOptions options = {}) : m_options(std::move(options)) {
+        m_threads = m_options.threads ? m_options.threads : default_threads();
+    }
+
+    [[nodiscard]] static unsigned default_threads() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    [[nodiscard]] unsigned threads() const { return m_threads; }
+
+    // Walks root, returning the number of directories that could not be read.
+    size_t walk(const fs::path& root, const WalkVisitor& visit) {
+        const int fd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            if (m_options.on_error) m_options.on_error("", errno);
+            return 1;
+        }
+        const size_t errors = walk(fd, visit);
+        close(fd);
+        return errors;
+    }
+
+    // Walks an already open directory. root_fd stays owned by the caller.
+    size_t walk(const int root_fd, const WalkVisitor& visit) {
+        m_rootFd = root_fd;
+        m_visit = &visit;
+        m_errors = 0;
+        m_queues.clear();
+        for (unsigned i = 0; i < m_threads; ++i) m_queues.push_back(std::make_unique<Queue>());
+
+        const int start = dup(root_fd);
+        m_outstanding = 1;
+        m_queues[0]->tasks.push_back({start, std::string()});
+        if (start >= 0) ++m_openFds;
+
+        std::vector<std::thread> workers;
+        workers.reserve(m_threads - 1);
+        for (unsigned i = 1; i < m_threads; ++i) {
+            workers.emplace_back([this, i] { worker(i); });
+        }
+        worker(0);
+        for (auto& t : workers) t.join();
+        return m_errors;
+    }
+
+private:
+    // Directories queued while fewer than this many are held open keep their fd;
+    // beyond that they are queued by path and reopened relative to the root.
+    static constexpr int kFdBudget = 512;
+    static constexpr size_t kBufferSize = 64 * 1024;
+
+    struct Task {
+        int fd; // -1 when the directory has to be reopened from rel
+        std::string rel;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool pop(const unsigned self, Task& task) {
+        {
+            Queue& own = *m_queues[self];
+            std::lock_guard lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (unsigned i = 1; i < m_threads; ++i) {
+            Queue& victim = *m_queues[(self + i) % m_threads];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker(const unsigned self) {
+        std::unique_ptr<char[]> buffer(new char[kBufferSize]);
+        Task task;
+        while (true) {
+            const uint64_t generation = m_generation.load();
+            if (pop(self, task)) {
+                process(self, task, buffer.get());
+                if (--m_outstanding == 0) wake();
+                continue;
+            }
+            if (m_outstanding.load() == 0) return;
+            ++m_sleepers;
+            m_generation.wait(generation);
+            --m_sleepers;
+        }
+    }
+
+    void wake() {
+        ++m_generation;
+        if (m_sleepers.load() > 0) m_generation.notify_all();
+    }
+
+    void process(const unsigned self, Task& task, char* buffer) {
+        int fd = task.fd;
+        if (fd >= 0) {
+            --m_openFds;
+        } else {
+            fd = openat(m_rootFd, task.rel.empty() ? "." : task.rel.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            profile::count(profile::Phase::Walk, 1);
+            if (fd < 0) return error(task.rel);
+        }
+
+        // Only the directory reads are timed as walking; the visitor times its own work
+        const auto read_batch = [&] {
+            const profile::ScopedTimer timer(profile::Phase::Walk);
+            profile::count(profile::Phase::Walk, 1);
+            return getdents64(fd, buffer, kBufferSize);
+        };
+        std::vector<Task> found;
+        ssize_t n;
+        while ((n = read_batch()) > 0) {
+            for (ssize_t off = 0; off < n;) {
+                const auto* d = reinterpret_cast<const dirent64*>(buffer + off);
+                off += d->d_reclen;
+
+                const char* name = d->d_name;
+                if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+                unsigned char type = d->d_type;
+                if (type == DT_UNKNOWN) {
+                    struct stat st{};
+                    profile::count(profile::Phase::Walk, 1);
+                    if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+                    type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : S_ISLNK(st.st_mode) ? DT_LNK : DT_UNKNOWN;
+                }
+
+                const WalkEntry entry{fd, name, task.rel, type, self};
+                if (!(*m_visit)(entry) || type != DT_DIR) continue;
+
+                int child = -1;
+                if (m_openFds.load() < kFdBudget) {
+                    child = openat(fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                    profile::count(profile::Phase::Walk, 1);
+                    if (child >= 0) ++m_openFds;
+                }
+                found.push_back({child, entry.rel_path()});
+            }
+        }
+        if (n < 0) error(task.rel);
+        close(fd);
+        profile::count(profile::Phase::Walk, 1);
+
+        if (!found.empty()) {
+            m_outstanding += found.size();
+            {
+                Queue& own = *m_queues[self];
+                std::lock_guard lock(own.mutex);
+                for (auto& t : found) own.tasks.push_back(std::move(t));
+            }
+            wake();
+        }
+    }
+
+    void error(const std::string& rel) {
+        ++m_errors;
+        if (m_options.on_error) m_options.on_error(rel, errno);
+    }
+
+    WalkOptions m_options;
+    unsigned m_threads = 1;
+    int m_rootFd = -1;
+    const WalkVisitor* m_visit = nullptr;
+    std::vector<std::unique_ptr<Queue>> m_queues;
+
+    std::atomic<size_t> m_outstanding{0};
+    std::atomic<size_t> m_errors{0};
+    std::atomic<int> m_openFds{0};
+    std::atomic<uint64_t> m_generation{0};
+    std::atomic<unsigned> m_sleepers{0};
+};
+
+struct TreeSize {
+    uint64_t files = 0; // Everything that is not a directory
+    uint64_t directories = 0;
+    uint64_t bytes = 0; // Apparent size
+    uint64_t disk = 0;  // Allocated size, like du
+};
+
+// du-style parallel sizer. The walk already knows each entry's type from getdents64,
+// so statx is asked only for size and block count and never forces a sync.
+inline TreeSize measure_tree(const fs::path& root, const unsigned threads = 0) {
+    struct alignas(64) Partial {
+        TreeSize size;
+    };
+    WalkOptions options;
+    options.threads = threads;
+    DirWalker walker(std::move(options));
+    std::vector<Partial> partials(walker.threads());
+
+    walker.walk(root, [&partials](const WalkEntry& entry) {
+        TreeSize& mine = partials[entry.worker].size;
+        if (entry.is_dir()) {
+            ++mine.directories;
+            return true;
+        }
+        ++mine.files;
+        struct statx stx{};
+        if (statx(entry.dir_fd, entry.name.data(), AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC,
+                  STATX_SIZE | STATX_BLOCKS, &stx) == 0) {
+            mine.bytes += stx.stx_size;
+            mine.disk += stx.stx_blocks * 512;
+        }
+        return true;
+    });
+
+    TreeSize total;
+    for (const auto& [size] : partials) {
+        total.files += size.files;
+        total.directories += size.directories;
+        total.bytes += size.bytes;
+        total.disk += size.disk;
+    }
+    return total;
+}
@@ -1,8 +1,19 @@
 #include "AutoInstaller.hpp"
 #include "print.hpp"
 #include "execute.hpp" // Assuming your thread-safe execute function is here
+#include "profile.hpp"
+#include "bulkcopy.hpp"
+#include "BatchManifest.hpp"
+#include "CloneManifest.hpp"
+#include "hash.hpp"
 #include <stdexcept>
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <unordered_set>
 
 #ifdef _WIN32
     #include <windows.h>
@@ -10,9 +21,11 @@
 #else
     #include <unistd.h>
     #include <sys/stat.h>
+    #include <fcntl.h>
 #endif
 
 void AutoInstaller::run(const char* target, const char* flags) {
+    const profile::ScopedTimer timer(profile::Phase::None, "dvk install");
     try {
         parseArguments(target, flags);
 
@@ -55,13 +68,369 @@ bool AutoInstaller::install(const std::string& sourceFile, const InstallMode mod
            verifyInstallation(fs::path(m_targetDir) / getFilename(m_sourceFile));
 }
 
+namespace {
+    // What earlier installs saw, so that installing an unchanged file costs two stats: every
+    // installed file and its source, by absolute path, with the XXH64 of its contents as of
+    // a size, mtime and inode. Kept as a CloneManifest in $XDG_STATE_HOME/dvk/installed
+    // (~/.local/state/dvk/installed).
+    class InstallRecord {
+    public:
+        InstallRecord() {
+            if (const char* state = std::getenv("XDG_STATE_HOME"); state && *state) {
+                m_path = fs::path(state) / "dvk" / "installed";
+            } else if (const char* home = std::getenv("HOME"); home && *home) {
+                m_path = fs::path(home) / ".local" / "state" / "dvk" / "installed";
+            }
+            if (m_path.empty() || !m_manifest.load(m_path)) m_manifest.setSnapshot("install");
+        }
+
+        // Whether target already holds source's contents with the given permissions
+        bool upToDate(const fs::path& source, const struct stat& sourceSt, const fs::path& target, const mode_t mode) {
+            struct stat st{};
+            if (lstat(target.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || (st.st_mode & 07777) != mode ||
+                st.st_size != sourceSt.st_size) {
+                return false;
+            }
+            uint64_t sourceHash = 0;
+            uint64_t targetHash = 0;
+            return hashOf(source, sourceSt, sourceHash) && hashOf(target, st, targetHash) && sourceHash == targetHash;
+        }
+
+        // Notes a file just installed from source, so the next install can skip it. The copy
+        // is recorded with the source's hash instead of being read back: it was written within
+        // the racy window anyway, so its mtime is stored as -1 and the next run verifies it.
+        void remember(const fs::path& source, const fs::path& target) {
+            struct stat st{};
+            uint64_t hash = 0;
+            if (stat(source.c_str(), &st) != 0 || !hashOf(source, st, hash)) return;
+            if (lstat(target.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return;
+            m_manifest.add(target.string(), {hash, static_cast<uint64_t>(st.st_size), -1, st.st_ino, st.st_mode & 07777});
+            m_dirty = true;
+        }
+
+        void save() const {
+            if (!m_dirty || m_path.empty()) return;
+            std::error_code ec;
+            fs::create_directories(m_path.parent_path(), ec);
+            if (!m_manifest.save(m_path)) print::debug("Cannot save install record '{}'", m_path.string());
+        }
+
+    private:
+        bool hashOf(const fs::path& path, const struct stat& st, uint64_t& hash) {
+            const int64_t mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+            if (const ManifestEntry* known = m_manifest.find(path.string());
+                known && known->size == static_cast<uint64_t>(st.st_size) && known->mtime_ns == mtime &&
+                known->inode == st.st_ino) {
+                hash = known->hash;
+                return true;
+            }
+            const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return false;
+            const bool hashed = hash_fd(fd, hash);
+            close(fd);
+            if (!hashed) return false;
+
+            // A write in the same timestamp tick as this hash would leave the mtime alone,
+            // so a file modified in the last two seconds is hashed again next time
+            ManifestEntry entry{hash, static_cast<uint64_t>(st.st_size), mtime, st.st_ino, st.st_mode & 07777};
+            if (std::time(nullptr) - st.st_mtim.tv_sec < 2) entry.mtime_ns = -1;
+            m_manifest.add(path.string(), entry);
+            m_dirty = true;
+            return true;
+        }
+
+        fs::path m_path;
+        CloneManifest m_manifest;
+        bool m_dirty = false;
+    };
+
+    // One file of an install batch
+    struct BatchItem {
+        fs::path source;      // Absolute
+        std::string name;     // File name in the target directory
+        fs::path target;      // Target directory
+        InstallMode mode = InstallMode::Copy;
+        int line = 0;         // Manifest line; 0 when installing a directory
+        struct stat st{};
+        size_t sourceDir = 0; // Indices into the opened directories
+        size_t targetDir = 0;
+        std::string stage;
+        std::string error;
+        bool upToDate = false; // Already installed with these contents and permissions
+    };
+
+    // Index of dir in dirs, appending it when it is new
+    size_t dirIndex(std::vector<fs::path>& dirs, const fs::path& dir) {
+        const auto it = std::ranges::find(dirs, dir);
+        if (it != dirs.end()) return static_cast<size_t>(it - dirs.begin());
+        dirs.push_back(dir);
+        return dirs.size() - 1;
+    }
+}
+
+// The manifest lists one [[file]] per tool; [defaults] may set target and mode. A file's
+// own target wins, then --to (targetDir), then [defaults], then /usr/local/bin:
+//
+//   [defaults]
+//   target = "/usr/local/bin"
+//   [[file]]
+//   source = "tools/deploy.sh"   -- relative paths are relative to the manifest
+//   name = "deploy"              -- optional, the source's file name by default
+//   mode = "link"                -- "copy" (default) or "link"
+int AutoInstaller::runBatch(const fs::path& source, const std::string& targetDir, const unsigned threads) {
+    const profile::ScopedTimer timer(profile::Phase::None, "dvk install --batch");
+    const auto start = std::chrono::steady_clock::now();
+    const fs::path defaultTarget = targetDir.empty() ? fs::path("/usr/local/bin") : fs::path(targetDir);
+    std::error_code ec;
+
+    std::vector<BatchItem> items;
+    bool valid = true;
+    const auto invalid = [&](const BatchItem& item, const std::string& why) {
+        if (item.line > 0) print::error("{}:{}: {}", source.string(), item.line, why);
+        else print::error("{}: {}", item.source.string(), why);
+        valid = false;
+    };
+
+    if (fs::is_directory(source, ec)) {
+        // Every visible file directly inside the directory
+        for (const auto& entry : fs::directory_iterator(source, ec)) {
+            std::string name = entry.path().filename().string();
+            if (name.starts_with('.') || !entry.is_regular_file(ec)) continue;
+            BatchItem& item = items.emplace_back();
+            item.source = fs::absolute(entry.path(), ec);
+            item.name = std::move(name);
+            item.target = defaultTarget;
+        }
+        if (ec) {
+            print::error("Cannot read '{}': {}", source.string(), ec.message());
+            return 1;
+        }
+        std::ranges::sort(items, {}, &BatchItem::name);
+    } else {
+        BatchManifest manifest;
+        std::string error;
+        if (!manifest.load(source, error)) {
+            print::error("{}", error);
+            return 1;
+        }
+        const fs::path base = fs::absolute(source, ec).parent_path();
+        const BatchManifest::Table* defaults = manifest.table("defaults");
+        const auto setting = [defaults](const BatchManifest::Table& entry, const std::string_view key) {
+            const std::string* value = entry.find(key);
+            if (!value && defaults) value = defaults->find(key);
+            return value ? *value : std::string();
+        };
+        const auto checkKeys = [&](const BatchManifest::Table& table, const bool perFile) {
+            bool ok = true;
+            for (const auto& [key, value] : table.values) {
+                if (key != "target" && key != "mode" && (!perFile || (key != "source" && key != "name"))) {
+                    print::error("{}:{}: unknown key '{}' in [{}]", source.string(), table.line, key, table.name);
+                    ok = false;
+                }
+            }
+            return ok;
+        };
+        valid = !defaults || checkKeys(*defaults, false);
+        for (const BatchManifest::Table* entry : manifest.array("file")) {
+            if (!checkKeys(*entry, true)) {
+                valid = false;
+                continue;
+            }
+            BatchItem item;
+            item.line = entry->line;
+            const std::string from = setting(*entry, "source");
+            const std::string mode = setting(*entry, "mode");
+            // --to only gives way to a target the entry sets itself, not to [defaults]
+            const std::string* target = entry->find("target");
+            if (!target && targetDir.empty() && defaults) target = defaults->find("target");
+            item.source = (base / from).lexically_normal();
+            item.name = entry->find("name") ? *entry->find("name") : item.source.filename().string();
+            item.target = target && !target->empty() ? base / *target : defaultTarget;
+            item.mode = mode == "link" ? InstallMode::Link : InstallMode::Copy;
+            if (from.empty()) invalid(item, "missing 'source'");
+            else if (!mode.empty() && mode != "copy" && mode != "link") invalid(item, fmt::format("unknown mode '{}' (copy, link)", mode));
+            else items.push_back(std::move(item));
+        }
+    }
+
+    // Everything is checked before anything is installed
+    std::unordered_set<std::string> destinations;
+    std::unordered_set<std::string> checkedTargets;
+    for (BatchItem& item : items) {
+        item.target = fs::absolute(item.target, ec).lexically_normal();
+        const fs::path destination = item.target / item.name;
+        if (item.name.empty() || item.name == "." || item.name == ".." || item.name.find('/') != std::string::npos) {
+            invalid(item, fmt::format("invalid file name '{}'", item.name));
+        } else if (stat(item.source.c_str(), &item.st) != 0) {
+            invalid(item, fmt::format("cannot read '{}': {}", item.source.string(), std::strerror(errno)));
+        } else if (!S_ISREG(item.st.st_mode)) {
+            invalid(item, fmt::format("'{}' is not a regular file", item.source.string()));
+        } else if (!destinations.insert(destination.string()).second) {
+            invalid(item, fmt::format("'{}' is installed twice", destination.string()));
+        } else if (checkedTargets.insert(item.target.string()).second) {
+            if (!fs::is_directory(item.target, ec)) invalid(item, fmt::format("target directory '{}' does not exist", item.target.string()));
+            else if (!hasWritePermission(item.target) && !isRoot()) invalid(item, fmt::format("no write permission to '{}'", item.target.string()));
+        }
+    }
+    if (!valid) {
+        print::error("Nothing was installed.");
+        return 1;
+    }
+    if (items.empty()) {
+        print::warn("'{}' has nothing to install.", source.string());
+        return 0;
+    }
+
+    // Each directory is opened once; files are staged and renamed relative to it
+    std::vector<fs::path> sourceDirs;
+    std::vector<fs::path> targetDirs;
+    for (BatchItem& item : items) {
+        item.sourceDir = dirIndex(sourceDirs, item.source.parent_path());
+        item.targetDir = dirIndex(targetDirs, item.target);
+    }
+    std::vector<int> sourceFds;
+    std::vector<int> targetFds;
+    const auto closeAll = [&] {
+        for (const int fd : sourceFds) if (fd >= 0) close(fd);
+        for (const int fd : targetFds) if (fd >= 0) close(fd);
+    };
+    for (const auto& [dirs, fds] : {std::pair{&sourceDirs, &sourceFds}, std::pair{&targetDirs, &targetFds}}) {
+        for (const auto& dir : *dirs) {
+            fds->push_back(open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+            if (fds->back() < 0) {
+                print::error("Cannot open '{}': {}", dir.string(), std::strerror(errno));
+                closeAll();
+                return 1;
+            }
+        }
+    }
+
+    // Copies whose target already matches are skipped
+    InstallRecord record;
+    size_t upToDate = 0;
+    for (BatchItem& item : items) {
+        const mode_t mode = (item.st.st_mode & 07777) | S_IXUSR | S_IXGRP | S_IXOTH;
+        if (item.mode == InstallMode::Copy && record.upToDate(item.source, item.st, item.target / item.name, mode)) {
+            item.upToDate = true;
+            ++upToDate;
+        }
+    }
+
+    // Stage: copies go through the bulk copy backend in one call, created executable;
+    // links are made under the staging name
+    size_t byStrategy[bulkcopy::kStrategies]{};
+    size_t links = 0;
+    {
+        const profile::ScopedTimer copyTimer(profile::Phase::Copy);
+        std::vector<FileCopy> copies;
+        std::vector<BatchItem*> copied;
+        const std::string suffix = fmt::format(".dvk-install-{}", getpid());
+        for (BatchItem& item : items) {
+            if (item.upToDate) continue;
+            item.stage = "." + item.name + suffix;
+            unlinkat(targetFds[item.targetDir], item.stage.c_str(), 0); // Left over by a crashed run
+            if (item.mode == InstallMode::Link) {
+                // A link runs the source itself, so that is what has to be executable
+                if (!(item.st.st_mode & S_IXUSR)) chmod(item.source.c_str(), (item.st.st_mode & 07777) | S_IXUSR | S_IXGRP | S_IXOTH);
+                if (symlinkat(item.source.c_str(), targetFds[item.targetDir], item.stage.c_str()) != 0) {
+                    item.error = fmt::format("cannot create link: {}", std::strerror(errno));
+                } else {
+                    ++links;
+                }
+                continue;
+            }
+            copies.push_back({sourceFds[item.sourceDir], nullptr, targetFds[item.targetDir], item.stage.c_str(),
+                              static_cast<uint64_t>(item.st.st_size), (item.st.st_mode & 07777) | S_IXUSR | S_IXGRP | S_IXOTH});
+            copied.push_back(&item);
+        }
+        // Source names point into items, which no longer move
+        std::vector<std::string> names;
+        names.reserve(copied.size());
+        for (size_t i = 0; i < copied.size(); ++i) {
+            names.push_back(copied[i]->source.filename().string());
+            copies[i].src = names.back().c_str();
+        }
+        const unsigned workers = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+        copy_files(copies, workers);
+        for (size_t i = 0; i < copies.size(); ++i) {
+            if (copies[i].error) copied[i]->error = fmt::format("cannot copy: {}", std::strerror(copies[i].error));
+            else ++byStrategy[static_cast<size_t>(copies[i].strategy)];
+        }
+    }
+
+    // Publish: every staged file is renamed over its target, which atomically replaces
+    // whatever was there. Nothing is published while any file failed to stage.
+    const bool staged = std::ranges::none_of(items, [](const BatchItem& item) { return !item.error.empty(); });
+    size_t installed = 0;
+    for (BatchItem& item : items) {
+        if (item.upToDate) continue;
+        const int fd = targetFds[item.targetDir];
+        if (staged && renameat(fd, item.stage.c_str(), fd, item.name.c_str()) == 0) {
+            if (item.mode == InstallMode::Copy) record.remember(item.source, item.target / item.name);
+            ++installed;
+            continue;
+        }
+        if (staged) item.error = fmt::format("cannot move into place: {}", std::strerror(errno));
+        unlinkat(fd, item.stage.c_str(), 0);
+    }
+
+    // Verify every installed file in one pass over the open directories
+    size_t verified = 0;
+    if (installed + upToDate > 0) {
+        const profile::ScopedTimer verifyTimer(profile::Phase::Verify);
+        for (BatchItem& item : items) {
+            if (!item.error.empty()) continue;
+            const int fd = targetFds[item.targetDir];
+            struct stat st{};
+            if (fstatat(fd, item.name.c_str(), &st, 0) != 0 || !S_ISREG(st.st_mode) ||
+                faccessat(fd, item.name.c_str(), X_OK, 0) != 0) {
+                item.error = "installed, but not executable";
+            } else {
+                ++verified;
+            }
+        }
+        profile::count(profile::Phase::Verify, 2 * (installed + upToDate));
+    }
+    closeAll();
+    record.save();
+
+    for (const BatchItem& item : items) {
+        if (!item.error.empty()) print::error("{}: {}", (item.target / item.name).string(), item.error);
+        else LOG_DEBUG("Installed: {} -> {}", item.source.string(), (item.target / item.name).string());
+    }
+    std::string how;
+    for (size_t i = 0; i < bulkcopy::kStrategies; ++i) {
+        if (byStrategy[i] == 0) continue;
+        how += fmt::format("{}{} {}", how.empty() ? "" : ", ", byStrategy[i], bulkcopy::strategy_name(static_cast<bulkcopy::Strategy>(i)));
+    }
+    if (links > 0) how += fmt::format("{}{} linked", how.empty() ? "" : ", ", links);
+    if (upToDate > 0) how += fmt::format("{}{} up to date", how.empty() ? "" : ", ", upToDate);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (!staged) {
+        print::error("Nothing was installed.");
+        return 1;
+    }
+    if (verified != items.size()) {
+        print::error("Installed {}/{} files in {:.1f} ms", verified, items.size(), ms);
+        return 1;
+    }
+    if (upToDate == items.size()) {
+        print::success("All {} files are up to date ({:.1f} ms)", upToDate, ms);
+        return 0;
+    }
+    print::success("Installed and verified {} files in {:.1f} ms ({})", verified, ms, how);
+    return 0;
+}
+
 void AutoInstaller::showUsage(const std::string& programName) {
     print::info("Usage: {} <file> [--link|--auto]", programName);
+    print::info("       {} --batch <dir|manifest.toml> [--to <dir>] [-j <threads>]", programName);
     print::info("");
     print::info("Options:");
     print::info("  (default)  Copy file to /usr/local/bin");
     print::info("  --link     Create symbolic link instead of copying");
     print::info("  --auto     Auto-detect bin path using existing commands");
+    print::info("  --batch    Install every file of a directory or manifest, replacing each atomically");
     print::info("");
     print::info("Examples:");
     print::info("  {} myscript              # Copy to /usr/local/bin/myscript", programName);
@@ -96,14 +465,12 @@ void AutoInstaller::parseArguments(const char* target, const char* flags) {
 
 std::string AutoInstaller::autoDetectPath() {
     for (const std::vector<std::string> testCommands = {"ls", "cat", "echo", "sh", "which"}; const auto& cmd : testCommands) {
-        if (CommandResult result = execute(fmt::format("which {}", cmd)); result.exit_code == 0 && !result.stdout_output.empty()) {
-            // Remove newline if present
-            std::erase(result.stdout_output, '\n');
-
-            if (fs::path cmdPath(result.stdout_output); fs::exists(cmdPath) && fs::is_regular_file(cmdPath)) {
-                if (fs::path binDir = cmdPath.parent_path(); hasWritePermission(binDir) || isRoot()) {
-                    return binDir.string();
-                }
+        // The resolver already checked for an executable regular file; no `which` to spawn.
+        // Only trusted PATH entries count: a stray "." must not make the current directory a target.
+        if (const std::string resolved = CommandResolver::instance().resolve(cmd, CommandResolver::Search::Trusted);
+            !resolved.empty()) {
+            if (fs::path binDir = fs::path(resolved).parent_path(); hasWritePermission(binDir) || isRoot()) {
+                return binDir.string();
             }
         }
     }
@@ -165,6 +532,7 @@ bool AutoInstaller::checkTargetDirectory() const {
 }
 
 bool AutoInstaller::performInstallation() const {
+    const profile::ScopedTimer timer(profile::Phase::Copy);
     const fs::path sourcePath = getAbsolutePath(m_sourceFile);
     const fs::path targetPath = fs::path(m_targetDir) / getFilename(m_sourceFile);
 
@@ -173,6 +541,23 @@ bool AutoInstaller::performInstallation() const {
         return false;
     }
 
+    // An identical copy already in place is left alone
+    struct stat st{};
+    InstallRecord record;
+    if (m_mode != InstallMode::Link) {
+        const auto start = std::chrono::steady_clock::now();
+        if (stat(sourcePath.c_str(), &st) != 0) {
+            print::error("Failed to copy file: {}", std::strerror(errno));
+            return false;
+        }
+        if (record.upToDate(sourcePath, st, targetPath, (st.st_mode & 07777) | S_IXUSR | S_IXGRP | S_IXOTH)) {
+            record.save();
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            print::success("'{}' is up to date in '{}' ({:.2f} ms)", getFilename(m_sourceFile), m_targetDir, ms);
+            return true;
+        }
+    }
+
     // Remove existing target if it exists
     if (!removeExisting(targetPath)) {
         return false;
@@ -183,16 +568,34 @@ bool AutoInstaller::performInstallation() const {
     switch (m_mode) {
         case InstallMode::Copy:
         case InstallMode::Auto:
+        {
             print::info("Copying '{}' to '{}'...", sourcePath.string(), targetPath.string());
-            fs::copy_file(sourcePath, targetPath, ec);
-            if (ec) {
-                print::error("Failed to copy file: {}", ec.message());
+            // Directory descriptors let the copy backend tell which filesystems are involved
+            const int src_dir = open(sourcePath.parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            const int dst_dir = open(targetPath.parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (src_dir < 0 || dst_dir < 0) {
+                print::error("Failed to copy file: {}", std::strerror(errno));
+                if (src_dir >= 0) close(src_dir);
+                if (dst_dir >= 0) close(dst_dir);
                 return false;
             }
-            if (!makeExecutable(targetPath)) {
+            const std::string name = sourcePath.filename().string();
+            const std::string target = targetPath.filename().string();
+            // The copy is created executable in one go, with no separate chmod pass
+            std::vector<FileCopy> copy{{src_dir, name.c_str(), dst_dir, target.c_str(),
+                                        static_cast<uint64_t>(st.st_size), (st.st_mode & 07777) | S_IXUSR | S_IXGRP | S_IXOTH}};
+            const size_t failed = copy_files(copy);
+            close(src_dir);
+            close(dst_dir);
+            if (failed != 0) {
+                print::error("Failed to copy file: {}", std::strerror(copy[0].error));
                 return false;
             }
+            print::info("Copied {} bytes ({})", st.st_size, bulkcopy::strategy_name(copy[0].strategy));
+            record.remember(sourcePath, targetPath);
+            record.save();
             break;
+        }
 
         case InstallMode::Link:
             print::info("Creating symbolic link '{}' -> '{}'...", targetPath.string(), sourcePath.string());
@@ -209,6 +612,7 @@ bool AutoInstaller::performInstallation() const {
 }
 
 bool AutoInstaller::verifyInstallation(const fs::path& targetPath) const {
+    const profile::ScopedTimer timer(profile::Phase::Verify);
     if (!fs::exists(targetPath)) {
         print::error("Installation failed - target does not exist");
         return false;
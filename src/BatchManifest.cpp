@@ -0,0 +1,140 @@
+// BatchManifest.cpp
+#include "BatchManifest.hpp"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <fmt/format.h>
+
+namespace {
+    std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+        return s;
+    }
+
+    bool isBareKey(const std::string_view key) {
+        return !key.empty() && std::ranges::all_of(key, [](const char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-';
+        });
+    }
+
+    // Parses a value starting at the front of s; the rest may only hold a comment
+    bool parseValue(std::string_view s, std::string& out, std::string& reason) {
+        out.clear();
+        if (s.empty()) {
+            reason = "missing value";
+            return false;
+        }
+        if (s.front() == '"') {
+            size_t i = 1;
+            for (; i < s.size() && s[i] != '"'; ++i) {
+                if (s[i] != '\\') {
+                    out.push_back(s[i]);
+                    continue;
+                }
+                if (++i == s.size()) break;
+                switch (s[i]) {
+                    case '"': out.push_back('"'); break;
+                    case '\\': out.push_back('\\'); break;
+                    case 'n': out.push_back('\n'); break;
+                    case 't': out.push_back('\t'); break;
+                    default:
+                        reason = fmt::format("unsupported escape '\\{}'", s[i]);
+                        return false;
+                }
+            }
+            if (i >= s.size()) {
+                reason = "unterminated string";
+                return false;
+            }
+            s.remove_prefix(i + 1);
+        } else if (s.front() == '\'') {
+            const size_t end = s.find('\'', 1);
+            if (end == std::string_view::npos) {
+                reason = "unterminated string";
+                return false;
+            }
+            out = s.substr(1, end - 1);
+            s.remove_prefix(end + 1);
+        } else if (s.front() == '[' || s.front() == '{') {
+            reason = "arrays and inline tables are not supported";
+            return false;
+        } else {
+            const size_t end = s.find_first_of(" \t#");
+            out = s.substr(0, end);
+            s.remove_prefix(end == std::string_view::npos ? s.size() : end);
+        }
+        s = trim(s);
+        if (!s.empty() && s.front() != '#') {
+            reason = "unexpected text after value";
+            return false;
+        }
+        return true;
+    }
+}
+
+const std::string* BatchManifest::Table::find(const std::string_view key) const {
+    for (const auto& [k, v] : values) {
+        if (k == key) return &v;
+    }
+    return nullptr;
+}
+
+bool BatchManifest::load(const std::filesystem::path& path, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = fmt::format("{}: cannot open file", path.string());
+        return false;
+    }
+    m_tables.clear();
+    m_tables.push_back({});
+
+    std::string raw;
+    std::string value;
+    std::string reason;
+    for (int line_no = 1; std::getline(file, raw); ++line_no) {
+        const auto fail = [&](const std::string& why) {
+            error = fmt::format("{}:{}: {}", path.string(), line_no, why);
+            return false;
+        };
+        const std::string_view line = trim(raw);
+        if (line.empty() || line.front() == '#') continue;
+
+        if (line.front() == '[') {
+            const bool array = line.starts_with("[[");
+            const std::string_view close = array ? "]]" : "]";
+            const size_t end = line.find(close);
+            if (end == std::string_view::npos) return fail("unterminated table header");
+            const std::string_view name = trim(line.substr(array ? 2 : 1, end - (array ? 2 : 1)));
+            const std::string_view rest = trim(line.substr(end + close.size()));
+            if (!isBareKey(name)) return fail(fmt::format("unsupported table name '{}'", name));
+            if (!rest.empty() && rest.front() != '#') return fail("unexpected text after table header");
+            if (!array && table(name)) return fail(fmt::format("table [{}] defined twice", name));
+            m_tables.push_back({std::string(name), array, line_no, {}});
+            continue;
+        }
+
+        const size_t eq = line.find('=');
+        if (eq == std::string_view::npos) return fail("expected 'key = value'");
+        const std::string_view key = trim(line.substr(0, eq));
+        if (!isBareKey(key)) return fail(fmt::format("unsupported key '{}'", key));
+        if (!parseValue(trim(line.substr(eq + 1)), value, reason)) return fail(reason);
+        Table& current = m_tables.back();
+        if (current.find(key)) return fail(fmt::format("duplicate key '{}'", key));
+        current.values.emplace_back(std::string(key), value);
+    }
+    return true;
+}
+
+const BatchManifest::Table* BatchManifest::table(const std::string_view name) const {
+    const auto it = std::ranges::find_if(m_tables, [name](const Table& t) { return !t.array && t.name == name; });
+    return it == m_tables.end() ? nullptr : &*it;
+}
+
+std::vector<const BatchManifest::Table*> BatchManifest::array(const std::string_view name) const {
+    std::vector<const Table*> entries;
+    for (const auto& t : m_tables) {
+        if (t.array && t.name == name) entries.push_back(&t);
+    }
+    return entries;
+}
@@ -0,0 +1,117 @@
+// BinaryLog.cpp
+#include "binlog.hpp"
+#include <fstream>
+#include <iterator>
+#include <fmt/args.h>
+#include <fmt/format.h>
+
+namespace {
+    constexpr const char* kLevelNames[] = {"TRACE", "DEBUG", "INFO", "WARNING", "ERROR"};
+
+    class Reader {
+    public:
+        explicit Reader(std::string data) : m_data(std::move(data)) {}
+
+        [[nodiscard]] bool done() const { return m_pos >= m_data.size(); }
+        [[nodiscard]] bool ok() const { return m_ok; }
+
+        template<typename V>
+        V get() {
+            V value{};
+            if (m_pos + sizeof(V) > m_data.size()) {
+                m_ok = false;
+                return value;
+            }
+            std::memcpy(&value, m_data.data() + m_pos, sizeof(V));
+            m_pos += sizeof(V);
+            return value;
+        }
+
+        std::string_view bytes(const size_t size) {
+            if (m_pos + size > m_data.size()) {
+                m_ok = false;
+                return {};
+            }
+            const std::string_view view(m_data.data() + m_pos, size);
+            m_pos += size;
+            return view;
+        }
+
+    private:
+        std::string m_data;
+        size_t m_pos = 0;
+        bool m_ok = true;
+    };
+
+    struct Format {
+        uint8_t level = 0;
+        std::string text;
+    };
+}
+
+bool print::binlog::decode(const std::string& path, FILE* out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    Reader in(std::string(std::istreambuf_iterator<char>(file), {}));
+    if (in.bytes(sizeof(kMagic)) != std::string_view(kMagic, sizeof(kMagic))) return false;
+
+    std::vector<Format> formats;
+    fmt::memory_buffer line;
+    while (!in.done() && in.ok()) {
+        const auto type = in.get<char>();
+        if (type == 'F') {
+            const auto id = in.get<uint32_t>();
+            const auto level = in.get<uint8_t>();
+            const auto text = in.bytes(in.get<uint32_t>());
+            if (!in.ok()) break;
+            if (id >= formats.size()) formats.resize(id + 1);
+            formats[id] = {level, std::string(text)};
+            continue;
+        }
+        if (type != 'E') {
+            fmt::print(stderr, "Corrupt record in '{}'\n", path);
+            return false;
+        }
+
+        const auto id = in.get<uint32_t>();
+        const auto time_ns = in.get<uint64_t>();
+        const auto thread = in.get<uint32_t>();
+        const auto argc = in.get<uint8_t>();
+        fmt::dynamic_format_arg_store<fmt::format_context> args;
+        for (unsigned i = 0; i < argc && in.ok(); ++i) {
+            switch (static_cast<Tag>(in.get<uint8_t>())) {
+                case Tag::Int: args.push_back(in.get<int64_t>()); break;
+                case Tag::UInt: args.push_back(in.get<uint64_t>()); break;
+                case Tag::Double: args.push_back(in.get<double>()); break;
+                case Tag::Bool: args.push_back(in.get<uint8_t>() != 0); break;
+                case Tag::Char: args.push_back(in.get<char>()); break;
+                case Tag::String: args.push_back(std::string(in.bytes(in.get<uint32_t>()))); break;
+                default: in.bytes(SIZE_MAX); break; // Unknown tag: stop at the ok() check
+            }
+        }
+        if (!in.ok()) break;
+        if (id >= formats.size()) {
+            fmt::print(stderr, "Record refers to unknown format {} in '{}'\n", id, path);
+            return false;
+        }
+
+        const time_t seconds = static_cast<time_t>(time_ns / 1000000000u);
+        tm local{};
+        localtime_r(&seconds, &local);
+        char stamp[24];
+        strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+        const Format& format = formats[id];
+        line.clear();
+        fmt::format_to(std::back_inserter(line), "[{}.{:03}] [{}] [t{}] ", stamp, time_ns / 1000000 % 1000,
+                       format.level < std::size(kLevelNames) ? kLevelNames[format.level] : "?", thread);
+        try {
+            fmt::vformat_to(std::back_inserter(line), format.text, args);
+        } catch (const fmt::format_error& e) {
+            fmt::format_to(std::back_inserter(line), "<{}: {}>", format.text, e.what());
+        }
+        line.push_back('\n');
+        fwrite(line.data(), 1, line.size(), out);
+    }
+    if (!in.ok()) fmt::print(stderr, "'{}' ends with a truncated record\n", path);
+    return true;
+}
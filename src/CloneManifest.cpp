@@ -0,0 +1,100 @@
+// CloneManifest.cpp
+#include "CloneManifest.hpp"
+#include "print.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <fstream>
+#include <vector>
+#include <fmt/format.h>
+#include <unistd.h>
+
+namespace {
+    constexpr std::string_view kHeader = "# dvk-manifest 1";
+    constexpr std::string_view kSnapshotKey = "snapshot ";
+
+    // Parses the next tab-separated field of line as an integer
+    template<typename T>
+    bool parseField(std::string_view& line, T& out, const int base = 10) {
+        const size_t tab = line.find('\t');
+        if (tab == std::string_view::npos) return false;
+        const auto [ptr, ec] = std::from_chars(line.data(), line.data() + tab, out, base);
+        if (ec != std::errc() || ptr != line.data() + tab) return false;
+        line.remove_prefix(tab + 1);
+        return true;
+    }
+}
+
+std::filesystem::path CloneManifest::pathFor(const std::filesystem::path& parent, const std::string& project) {
+    return parent / ("." + project + ".dvk-manifest");
+}
+
+bool CloneManifest::load(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    if (!file) return false;
+
+    std::string line;
+    if (!std::getline(file, line) || line != kHeader) return false;
+    if (!std::getline(file, line) || !line.starts_with(kSnapshotKey)) return false;
+    m_snapshot = line.substr(kSnapshotKey.size());
+    m_entries.clear();
+
+    // hash  size  mtime_ns  inode  mode  path
+    while (std::getline(file, line)) {
+        std::string_view rest(line);
+        ManifestEntry entry;
+        unsigned mode = 0;
+        if (!parseField(rest, entry.hash, 16) || !parseField(rest, entry.size) || !parseField(rest, entry.mtime_ns) ||
+            !parseField(rest, entry.inode) || !parseField(rest, mode, 8) || rest.empty()) {
+            print::warn("Ignoring malformed manifest line in '{}'", path.string());
+            continue;
+        }
+        entry.mode = static_cast<mode_t>(mode);
+        m_entries.insert_or_assign(std::string(rest), entry);
+    }
+    return true;
+}
+
+bool CloneManifest::save(const std::filesystem::path& path) const {
+    std::vector<const std::pair<const std::string, ManifestEntry>*> sorted;
+    sorted.reserve(m_entries.size());
+    for (const auto& kv : m_entries) sorted.push_back(&kv);
+    std::ranges::sort(sorted, {}, [](const auto* kv) { return std::string_view(kv->first); });
+
+    // The install record is shared by every dvk install on the host, so concurrent saves
+    // each write their own file and the last rename wins whole
+    static std::atomic<unsigned> s_saves{0};
+    const std::filesystem::path tmp = fmt::format("{}.{}.{}.tmp", path.string(), getpid(), s_saves++);
+    std::error_code ec;
+    {
+        std::ofstream file(tmp, std::ios::trunc);
+        if (!file) return false;
+        fmt::memory_buffer out;
+        fmt::format_to(std::back_inserter(out), "{}\n{}{}\n", kHeader, kSnapshotKey, m_snapshot);
+        for (const auto* kv : sorted) {
+            const ManifestEntry& e = kv->second;
+            fmt::format_to(std::back_inserter(out), "{:016x}\t{}\t{}\t{}\t{:o}\t{}\n",
+                           e.hash, e.size, e.mtime_ns, e.inode, static_cast<unsigned>(e.mode), kv->first);
+        }
+        file.write(out.data(), static_cast<std::streamsize>(out.size()));
+        file.close();
+        if (!file) {
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) std::filesystem::remove(tmp, ec);
+    return !ec;
+}
+
+const ManifestEntry* CloneManifest::find(const std::string_view rel) const {
+    const auto it = m_entries.find(rel);
+    return it == m_entries.end() ? nullptr : &it->second;
+}
+
+void CloneManifest::add(std::string rel, const ManifestEntry& entry) {
+    // One line per file: names containing a newline cannot be recorded
+    if (rel.find('\n') != std::string::npos) return;
+    m_entries.insert_or_assign(std::move(rel), entry);
+}
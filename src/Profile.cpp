@@ -0,0 +1,70 @@
+// Profile.cpp
+#include "profile.hpp"
+#include "print.hpp"
+#include <cstdio>
+#include <iterator>
+#include <sys/resource.h>
+#include <fmt/format.h>
+
+namespace {
+    double ms(const uint64_t ns) { return static_cast<double>(ns) / 1e6; }
+
+    uint64_t processCpuNs() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        const auto ns = [](const timeval& tv) {
+            return static_cast<uint64_t>(tv.tv_sec) * 1000000000u + static_cast<uint64_t>(tv.tv_usec) * 1000u;
+        };
+        return ns(usage.ru_utime) + ns(usage.ru_stime);
+    }
+}
+
+void profile::report(const uint64_t total_wall_ns) {
+    print::info("Profile: {:.1f} ms wall, {:.1f} ms CPU (phase times are summed across threads)",
+                ms(total_wall_ns), ms(processCpuNs()));
+    print::info("  {:<9} {:>9} {:>11} {:>11} {:>10} {:>12}", "phase", "calls", "wall ms", "cpu ms", "syscalls", "bytes");
+    for (size_t i = 0; i < kPhases; ++i) {
+        const auto& t = detail::g_totals[i];
+        const uint64_t calls = t.calls.load();
+        const uint64_t syscalls = t.syscalls.load();
+        if (calls == 0 && syscalls == 0) continue;
+        print::info("  {:<9} {:>9} {:>11.2f} {:>11.2f} {:>10} {:>12}", kPhaseNames[i], calls, ms(t.wall_ns.load()),
+                    ms(t.cpu_ns.load()), syscalls, t.bytes.load());
+    }
+}
+
+bool profile::write_trace(const std::string& path) {
+    FILE* out = fopen(path.c_str(), "w");
+    if (!out) return false;
+
+    const int pid = static_cast<int>(getpid());
+    fmt::memory_buffer json;
+    auto flushJson = [&] {
+        fwrite(json.data(), 1, json.size(), out);
+        json.clear();
+    };
+    fmt::format_to(std::back_inserter(json), "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    std::lock_guard lock(detail::g_threadsMutex);
+    for (const auto& thread : detail::g_threads) {
+        for (const auto& [name, phase, start_ns, duration_ns] : thread->events) {
+            // Names are string literals from the instrumented code: nothing to escape
+            fmt::format_to(std::back_inserter(json),
+                           "{}{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":{},\"tid\":{}}}",
+                           first ? "" : ",\n", name,
+                           phase == Phase::None ? "command" : kPhaseNames[static_cast<size_t>(phase)],
+                           static_cast<double>(start_ns) / 1e3, static_cast<double>(duration_ns) / 1e3, pid, thread->tid);
+            first = false;
+            if (json.size() > 1 << 20) flushJson();
+        }
+    }
+    fmt::format_to(std::back_inserter(json), "\n]}}\n");
+    flushJson();
+
+    const size_t recorded = detail::g_eventCount.load();
+    if (recorded > detail::kMaxEvents) {
+        print::warn("Trace truncated: kept {} of {} events", detail::kMaxEvents, recorded);
+    }
+    const bool written = !ferror(out);
+    return fclose(out) == 0 && written;
+}
@@ -2,12 +2,26 @@
 #include "ProjectCloner.hpp"
 #include "print.hpp"
 #include "execute.hpp"
+#include "TarArchiver.hpp"
+#include "CloneManifest.hpp"
+#include "hash.hpp"
+#include "profile.hpp"
+#include "bulkcopy.hpp"
 #include <iostream>
 #include <sstream>
 #include <chrono>
+#include <ctime>
 #include <iomanip>
 #include <fstream> // For permission check
 #include <utility>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
 
 const std::vector<std::string> m_excludePatterns = {
     "build", "Build", "cmake-build-*", "out", "bin", "obj", "node_modules",
@@ -17,12 +31,377 @@ const std::vector<std::string> m_excludePatterns = {
     "*.temp", ".DS_Store", "Thumbs.db", "*.log", "logs"
 };
 
+namespace {
+
+const GlobSet& excludeSet() {
+    static const GlobSet excludes(m_excludePatterns);
+    return excludes;
+}
+
+// Copies in to out through userspace so the contents can be hashed on the way.
+bool copyAndHash(const int in_fd, const int out_fd, uint64_t& hash) {
+    static constexpr size_t kBufSize = 256 * 1024;
+    thread_local std::unique_ptr<char[]> buf(new char[kBufSize]);
+    Xxh64 h;
+    uint64_t syscalls = 0, bytes = 0;
+    const auto finish = [&](const bool ok) {
+        profile::count(profile::Phase::Copy, syscalls, bytes);
+        return ok;
+    };
+    while (true) {
+        ++syscalls;
+        const ssize_t n = read(in_fd, buf.get(), kBufSize);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return finish(false);
+        }
+        if (n == 0) break;
+        bytes += static_cast<uint64_t>(n);
+        h.update(buf.get(), static_cast<size_t>(n));
+        for (ssize_t done = 0; done < n;) {
+            ++syscalls;
+            const ssize_t w = write(out_fd, buf.get() + done, static_cast<size_t>(n - done));
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return finish(false);
+            }
+            done += w;
+        }
+    }
+    hash = h.digest();
+    return finish(true);
+}
+
+std::string formatBytes(const uint64_t bytes) {
+    static constexpr const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+    auto value = static_cast<double>(bytes);
+    size_t unit = 0;
+    while (value >= 1024 && unit + 1 < std::size(units)) {
+        value /= 1024;
+        ++unit;
+    }
+    return unit == 0 ? fmt::format("{} B", bytes) : fmt::format("{:.1f} {}", value, units[unit]);
+}
+
+int64_t mtimeNs(const struct stat& st) {
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+// Parallel directory-tree copier driven by DirWalker. Excluded names are pruned
+// by the walk before they are ever opened.
+class TreeCopier {
+public:
+    TreeCopier(const int src_fd, const int dst_fd, const GlobSet& excludes)
+        : m_srcFd(src_fd), m_dstFd(dst_fd), m_excludes(excludes) {}
+
+    // Reuses unchanged files from the snapshot described by previous (opened as prev_fd,
+    // -1 when there is none) and records every copied file for the next manifest.
+    void setIncremental(const CloneManifest* previous, const int prev_fd) {
+        m_incremental = true;
+        m_previous = previous;
+        m_prevFd = prev_fd;
+    }
+
+    bool run(const unsigned threads) {
+        m_records.resize(threads);
+        m_pending.resize(threads);
+        struct stat root{};
+        if (fstat(m_srcFd, &root) == 0) {
+            m_dirMeta.push_back({"", root.st_mode & 07777, {root.st_atim, root.st_mtim}});
+        }
+
+        WalkOptions options;
+        options.threads = threads;
+        options.on_error = [this](const std::string& rel, const int err) {
+            errno = err;
+            fail(rel, "read directory");
+        };
+        DirWalker walker(std::move(options));
+        walker.walk(m_srcFd, [this](const WalkEntry& entry) { return visit(entry); });
+
+        // What is left of every worker's batch goes out in one parallel copy
+        {
+            const profile::ScopedTimer timer(profile::Phase::Copy);
+            std::vector<PendingCopy> rest;
+            for (auto& pending : m_pending) std::ranges::move(pending, std::back_inserter(rest));
+            flushCopies(rest, threads);
+        }
+
+        // Restore directory modes and times last, deepest first, so copying into them never fails.
+        std::ranges::sort(m_dirMeta, [](const DirMeta& a, const DirMeta& b) { return a.rel.size() > b.rel.size(); });
+        for (const auto& meta : m_dirMeta) {
+            const char* rel = meta.rel.empty() ? "." : meta.rel.c_str();
+            fchmodat(m_dstFd, rel, meta.mode, 0);
+            utimensat(m_dstFd, rel, meta.times, 0);
+        }
+        return m_failures == 0;
+    }
+
+    [[nodiscard]] size_t files() const { return m_files; }
+    [[nodiscard]] size_t directories() const { return m_dirs; }
+    [[nodiscard]] size_t failures() const { return m_failures; }
+    [[nodiscard]] size_t reused() const { return m_reused; }
+    [[nodiscard]] uint64_t bytes() const { return m_bytes; }
+
+    // How the copied files' data was copied, e.g. "reflink 812 files, io_uring 3 files"
+    [[nodiscard]] std::string strategies() const {
+        std::string summary;
+        for (size_t i = 0; i < bulkcopy::kStrategies; ++i) {
+            if (const size_t n = m_byStrategy[i]; n > 0) {
+                summary += fmt::format("{}{} {} file{}", summary.empty() ? "" : ", ",
+                                       bulkcopy::strategy_name(static_cast<bulkcopy::Strategy>(i)), n, n == 1 ? "" : "s");
+            }
+        }
+        return summary;
+    }
+
+    // Moves the recorded file entries into manifest.
+    void collect(CloneManifest& manifest) {
+        for (auto& chunk : m_records) {
+            for (auto& [rel, entry] : chunk) manifest.add(std::move(rel), entry);
+            chunk.clear();
+        }
+    }
+
+private:
+    struct DirMeta {
+        std::string rel;
+        mode_t mode;
+        timespec times[2];
+    };
+
+    struct PendingCopy {
+        std::string rel;
+        off_t size;
+        mode_t mode;
+        timespec times[2];
+    };
+
+    // Files a worker collects before copying them as one batch
+    static constexpr size_t kCopyBatch = 256;
+
+    void fail(const std::string& rel, const char* what) {
+        ++m_failures;
+        print::warn("Failed to {} '{}': {}", what, rel, std::strerror(errno));
+    }
+
+    bool visit(const WalkEntry& entry) {
+        const bool excluded = [&] {
+            const profile::ScopedTimer timer(profile::Phase::Match);
+            return m_excludes.matches(entry.name);
+        }();
+        if (excluded) {
+            LOG_TRACE("excluded '{}/{}'", entry.parent, entry.name);
+            return false;
+        }
+        const profile::ScopedTimer timer(profile::Phase::Copy);
+        const char* name = entry.name.data();
+
+        const std::string rel = entry.rel_path();
+        struct stat st{};
+        profile::count(profile::Phase::Copy, 1);
+        if (fstatat(entry.dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            fail(rel, "stat");
+            return false;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            // Created before the walker descends, so children always have a parent
+            if (mkdirat(m_dstFd, rel.c_str(), (st.st_mode & 07777) | S_IRWXU) != 0 && errno != EEXIST) {
+                fail(rel, "create directory");
+                return false;
+            }
+            ++m_dirs;
+            std::lock_guard lock(m_mutex);
+            m_dirMeta.push_back({rel, st.st_mode & 07777, {st.st_atim, st.st_mtim}});
+        } else if (S_ISREG(st.st_mode)) {
+            if (m_incremental) {
+                copyIncremental(entry.dir_fd, name, rel, st, entry.worker);
+            } else {
+                copyRegular(entry.worker, rel, st);
+            }
+        } else if (S_ISLNK(st.st_mode)) {
+            copySymlink(entry.dir_fd, name, rel, st);
+        } else {
+            print::warn("Skipping special file '{}'", rel);
+        }
+        return true;
+    }
+
+    // Queues a file for the worker's next copy_files() batch. The batch names files by
+    // their path from the source root, as the walker's directory descriptor is gone by then.
+    void copyRegular(const unsigned worker, std::string rel, const struct stat& st) {
+        auto& pending = m_pending[worker];
+        pending.push_back({std::move(rel), st.st_size, st.st_mode & 07777, {st.st_atim, st.st_mtim}});
+        if (pending.size() >= kCopyBatch) flushCopies(pending, 1);
+    }
+
+    void flushCopies(std::vector<PendingCopy>& pending, const unsigned threads) {
+        std::vector<FileCopy> batch;
+        batch.reserve(pending.size());
+        for (const auto& p : pending) {
+            batch.push_back({m_srcFd, p.rel.c_str(), m_dstFd, p.rel.c_str(), static_cast<uint64_t>(p.size), p.mode, p.times});
+        }
+        copy_files(batch, threads);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (batch[i].error) {
+                errno = batch[i].error;
+                fail(pending[i].rel, "copy");
+                continue;
+            }
+            ++m_files;
+            ++m_byStrategy[static_cast<size_t>(batch[i].strategy)];
+            m_bytes += batch[i].size;
+            LOG_TRACE("copied '{}' ({} bytes, {})", pending[i].rel, batch[i].size, bulkcopy::strategy_name(batch[i].strategy));
+        }
+        pending.clear();
+    }
+
+    void copyIncremental(const int dir_fd, const char* name, const std::string& rel, const struct stat& st,
+                         const unsigned worker) {
+        ManifestEntry current{0, static_cast<uint64_t>(st.st_size), mtimeNs(st), st.st_ino, st.st_mode & 07777};
+        const ManifestEntry* prev = m_previous ? m_previous->find(rel) : nullptr;
+        const bool same_size = prev && prev->size == current.size;
+
+        // Unchanged metadata: trust the recorded hash and share the previous copy
+        const bool unchanged = same_size && prev->mtime_ns == current.mtime_ns &&
+                               prev->inode == current.inode && prev->mode == current.mode;
+        if (unchanged) {
+            current.hash = prev->hash;
+            if (reusePrevious(rel, st, true)) {
+                LOG_TRACE("reused '{}' (unchanged)", rel);
+                return record(worker, rel, current);
+            }
+        }
+
+        const int in = openat(dir_fd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        if (in < 0) return fail(rel, "open");
+
+        // Same size but touched: the contents may still be identical
+        bool hashed = false;
+        if (same_size && !unchanged) {
+            hashed = hash_fd(in, current.hash) && lseek(in, 0, SEEK_SET) == 0;
+            // Hard links would carry the old timestamps, so only a reflink may be used here
+            if (hashed && current.hash == prev->hash && reusePrevious(rel, st, false)) {
+                LOG_TRACE("reused '{}' (same contents)", rel);
+                close(in);
+                return record(worker, rel, current);
+            }
+        }
+
+        const int out = openat(m_dstFd, rel.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        if (out < 0) {
+            close(in);
+            return fail(rel, "create");
+        }
+        auto strategy = hashed ? bulkcopy::Strategy::CopyRange : bulkcopy::Strategy::ReadWrite;
+        bool ok = hashed ? bulkcopy::copy_data(in, out, st.st_size, strategy) : copyAndHash(in, out, current.hash);
+        ok = ok && finishCopy(out, st);
+        close(in);
+        if (close(out) != 0) ok = false;
+        profile::count(profile::Phase::Copy, 6);
+        if (!ok) return fail(rel, "copy");
+        ++m_files;
+        ++m_byStrategy[static_cast<size_t>(strategy)];
+        m_bytes += current.size;
+        LOG_TRACE("copied '{}' ({} bytes, hash {:016x})", rel, current.size, current.hash);
+        record(worker, rel, current);
+    }
+
+    // Recreates rel from the previous snapshot: a reflink when the filesystem supports
+    // it, otherwise (if allowed) a hard link. False when the caller has to copy.
+    bool reusePrevious(const std::string& rel, const struct stat& st, const bool allow_hardlink) {
+        if (m_prevFd < 0) return false;
+        if (m_reflinkSupported) {
+            const int src = openat(m_prevFd, rel.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+            if (src >= 0) {
+                const int out = openat(m_dstFd, rel.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, S_IRUSR | S_IWUSR);
+                bool ok = false;
+                if (out >= 0) {
+                    if (ioctl(out, FICLONE, src) == 0) {
+                        ok = finishCopy(out, st);
+                    } else if (errno == EOPNOTSUPP || errno == EXDEV || errno == EINVAL || errno == ENOTTY) {
+                        m_reflinkSupported = false;
+                    }
+                    close(out);
+                    if (!ok) unlinkat(m_dstFd, rel.c_str(), 0);
+                }
+                close(src);
+                if (ok) {
+                    ++m_reused;
+                    ++m_files;
+                    m_bytes += static_cast<uint64_t>(st.st_size);
+                    return true;
+                }
+            }
+        }
+        profile::count(profile::Phase::Copy, allow_hardlink ? 1 : 0);
+        if (allow_hardlink && linkat(m_prevFd, rel.c_str(), m_dstFd, rel.c_str(), 0) == 0) {
+            ++m_reused;
+            ++m_files;
+            m_bytes += static_cast<uint64_t>(st.st_size);
+            return true;
+        }
+        return false;
+    }
+
+    static bool finishCopy(const int out, const struct stat& st) {
+        const timespec times[2] = {st.st_atim, st.st_mtim};
+        return fchmod(out, st.st_mode & 07777) == 0 && futimens(out, times) == 0;
+    }
+
+    void record(const unsigned worker, const std::string& rel, ManifestEntry entry) {
+        // A write in the same timestamp tick as this snapshot would leave size, mtime and
+        // inode alone, so a file modified in the last two seconds is hashed again next time
+        if (std::time(nullptr) - entry.mtime_ns / 1000000000 < 2) entry.mtime_ns = -1;
+        m_records[worker].emplace_back(rel, entry);
+    }
+
+    void copySymlink(const int dir_fd, const char* name, const std::string& rel, const struct stat& st) {
+        std::string target(static_cast<size_t>(st.st_size) + 1, '\0');
+        const ssize_t len = readlinkat(dir_fd, name, target.data(), target.size());
+        if (len < 0) return fail(rel, "read link");
+        target.resize(static_cast<size_t>(len));
+        if (symlinkat(target.c_str(), m_dstFd, rel.c_str()) != 0) return fail(rel, "create link");
+        const timespec times[2] = {st.st_atim, st.st_mtim};
+        utimensat(m_dstFd, rel.c_str(), times, AT_SYMLINK_NOFOLLOW);
+        profile::count(profile::Phase::Copy, 3);
+        ++m_files;
+    }
+
+    const int m_srcFd;
+    const int m_dstFd;
+    const GlobSet& m_excludes;
+
+    std::mutex m_mutex;
+    std::vector<DirMeta> m_dirMeta;
+
+    bool m_incremental = false;
+    const CloneManifest* m_previous = nullptr;
+    int m_prevFd = -1;
+    std::atomic<bool> m_reflinkSupported{true};
+    std::vector<std::vector<std::pair<std::string, ManifestEntry>>> m_records; // Per worker
+    std::vector<std::vector<PendingCopy>> m_pending;                          // Per worker
+
+    std::atomic<size_t> m_files{0};
+    std::atomic<size_t> m_dirs{0};
+    std::atomic<size_t> m_failures{0};
+    std::atomic<size_t> m_reused{0};
+    std::atomic<uint64_t> m_bytes{0};
+    std::atomic<size_t> m_byStrategy[bulkcopy::kStrategies] = {};
+};
+
+} // namespace
+
 ProjectCloner::ProjectCloner(const int argc, char* argv[], std::string  command_name)
     : m_argc(argc), m_argv(argv), m_commandName(std::move(command_name)) {}
 
 
 void ProjectCloner::run() {
-    parseArguments();
+    const profile::ScopedTimer timer(profile::Phase::None, "dvk clone");
+    if (!parseArguments()) {
+        return;
+    }
 
     m_currentPath = std::filesystem::current_path();
     m_parentPath = m_currentPath.parent_path();
@@ -30,7 +409,9 @@ void ProjectCloner::run() {
 
     validateEnvironment();
 
-    prepareBackupDestination();
+    if (!prepareBackupDestination()) {
+        return;
+    }
 
     performBackup();
 
@@ -38,7 +419,8 @@ void ProjectCloner::run() {
 }
 
 bool ProjectCloner::parseArguments() {
-    const std::vector<std::string> args(m_argv + 1, m_argv + m_argc);
+    // Skip the program name and the subcommand itself
+    const std::vector<std::string> args(m_argv + std::min(m_argc, 2), m_argv + m_argc);
     std::string suffix_arg;
 
     for (const auto& arg : args) {
@@ -48,6 +430,8 @@ bool ProjectCloner::parseArguments() {
         }
         if (arg == "-c" || arg == "--compress") {
             m_compress = true;
+        } else if (arg == "-i" || arg == "--incremental") {
+            m_incremental = true;
         } else if (arg.rfind('-', 0) == 0) {
             print::error("Unknown option: {}", arg);
             showUsage();
@@ -62,6 +446,11 @@ bool ProjectCloner::parseArguments() {
         }
     }
 
+    if (m_compress && m_incremental) {
+        print::error("--incremental cannot be combined with --compress.");
+        return false;
+    }
+
     if (suffix_arg.empty()) {
         const auto now = std::chrono::system_clock::now();
         const auto in_time_t = std::chrono::system_clock::to_time_t(now);
@@ -101,7 +490,7 @@ bool ProjectCloner::prepareBackupDestination() {
 
     if (std::filesystem::exists(m_backupPath)) {
         print::warn("Backup '{}'", m_backupPath.filename().string());
-        std::cout << "Overwrite? (y/N): ";
+        print::prompt("Overwrite? (y/N):");
         char response;
         std::cin >> response;
         if (response != 'y' && response != 'Y') {
@@ -119,65 +508,195 @@ bool ProjectCloner::prepareBackupDestination() {
     return true;
 }
 
-void ProjectCloner::performBackup() const {
+void ProjectCloner::performBackup() {
     print::info("Creating clean backup: {}", m_backupPath.filename().string());
     print::info("Source: {}", m_currentPath.string());
     print::info("Target: {}", m_backupPath.string());
 
+    const auto start = std::chrono::steady_clock::now();
     if (m_compress) {
-        return performTarBackup();
+        performTarBackup();
+    } else {
+        performCopyBackup();
     }
-    return performRsyncBackup();
+    m_stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 }
 
-void ProjectCloner::performRsyncBackup() const {
-    print::info("Using rsync for clean copy...");
-    std::stringstream cmd_ss;
-    cmd_ss << "rsync -av ";
-    for (const auto& pattern : m_excludePatterns) {
-        cmd_ss << "--exclude='" << pattern << "' ";
+void ProjectCloner::performCopyBackup() {
+    print::info("Using native copy engine for clean copy...");
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::error_code ec;
+    std::filesystem::create_directory(m_backupPath, ec);
+    if (ec) {
+        print::error("Failed to create backup directory: {}", ec.message());
+        return;
+    }
+
+    const int src_fd = open(m_currentPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    const int dst_fd = open(m_backupPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (src_fd < 0 || dst_fd < 0) {
+        print::error("Failed to open source or backup directory: {}", std::strerror(errno));
+        if (src_fd >= 0) close(src_fd);
+        if (dst_fd >= 0) close(dst_fd);
+        return;
+    }
+
+    TreeCopier copier(src_fd, dst_fd, excludeSet());
+
+    const auto manifest_path = CloneManifest::pathFor(m_parentPath, m_sourceDirName);
+    CloneManifest previous;
+    int prev_fd = -1;
+    if (m_incremental) {
+        if (previous.load(manifest_path)) {
+            prev_fd = open((m_parentPath / previous.snapshot()).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        }
+        if (prev_fd >= 0) {
+            print::info("Incremental: reusing unchanged files from '{}' ({} files)", previous.snapshot(), previous.size());
+        } else {
+            print::info("Incremental: no previous snapshot found, copying everything");
+        }
+        copier.setIncremental(prev_fd >= 0 ? &previous : nullptr, prev_fd);
+    }
+
+    const bool ok = copier.run(threads);
+    close(src_fd);
+    close(dst_fd);
+    if (prev_fd >= 0) close(prev_fd);
+
+    m_stats.files = copier.files();
+    m_stats.bytes = copier.bytes();
+    print::info("Copied {} files and {} directories ({} threads)", copier.files(), copier.directories(), threads);
+    if (const std::string strategies = copier.strategies(); !strategies.empty()) {
+        print::info("  Strategy: {}", strategies);
+    }
+    if (m_incremental) {
+        print::info("  Reused {} unchanged files, copied {}", copier.reused(), copier.files() - copier.reused());
+        CloneManifest next;
+        next.setSnapshot(m_backupPath.filename().string());
+        copier.collect(next);
+        if (!next.save(manifest_path)) {
+            print::warn("Failed to write manifest '{}'", manifest_path.string());
+        }
     }
-    // Add single quotes for robustness with paths containing spaces
-    cmd_ss << "'" << m_currentPath.string() << "/' '" << m_backupPath.string() << "/'";
-    if (execute(cmd_ss.str()).exit_code != 0) {
-        print::error("Failed to execute command");
+    if (!ok) {
+        print::error("Failed to copy {} entries", copier.failures());
     }
 }
 
-void ProjectCloner::performTarBackup() const {
-    print::info("Using tar for compressed archive...");
-    std::stringstream cmd_ss;
-    // -c: create, -z: gzip, -v: verbose, -f: file
-    cmd_ss << "tar -czvf ";
-    // Output file (the archive)
-    cmd_ss << "'" << m_backupPath.string() << "' ";
-    // Add exclude patterns
-    for (const auto& pattern : m_excludePatterns) {
-        cmd_ss << "--exclude='" << pattern << "' ";
-    }
-    cmd_ss << "-C '" << m_parentPath.string() << "' '" << m_sourceDirName << "'";
-    if (execute(cmd_ss.str()).exit_code != 0) {
-        print::error("Failed to execute command");
+void ProjectCloner::performTarBackup() {
+    print::info("Using native archiver for compressed archive...");
+    const unsigned threads = DirWalker::default_threads();
+
+    const int src_fd = open(m_currentPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    struct stat root{};
+    if (src_fd < 0 || fstat(src_fd, &root) != 0) {
+        print::error("Failed to open source directory: {}", std::strerror(errno));
+        if (src_fd >= 0) close(src_fd);
+        return;
+    }
+
+    // The walk is parallel but a tar stream is sequential: collect the pruned tree first
+    struct Entry {
+        std::string rel;
+        struct stat st;
+    };
+    std::vector<std::vector<Entry>> chunks(threads);
+    const GlobSet& excludes = excludeSet();
+    WalkOptions options;
+    options.threads = threads;
+    options.on_error = [](const std::string& rel, const int err) {
+        print::warn("Failed to read directory '{}': {}", rel, std::strerror(err));
+    };
+    DirWalker walker(std::move(options));
+    walker.walk(src_fd, [&](const WalkEntry& entry) {
+        const bool excluded = [&] {
+            const profile::ScopedTimer timer(profile::Phase::Match);
+            return excludes.matches(entry.name);
+        }();
+        if (excluded) return false;
+        struct stat st{};
+        profile::count(profile::Phase::Walk, 1);
+        if (fstatat(entry.dir_fd, entry.name.data(), &st, AT_SYMLINK_NOFOLLOW) != 0) return false;
+        chunks[entry.worker].push_back({entry.rel_path(), st});
+        return true;
+    });
+    std::vector<Entry> entries;
+    for (auto& chunk : chunks) std::ranges::move(chunk, std::back_inserter(entries));
+    std::ranges::sort(entries, {}, &Entry::rel);
+
+    TarArchiver archive(m_backupPath, threads);
+    if (!archive.open()) {
+        close(src_fd);
+        return;
+    }
+    archive.addDirectory(m_sourceDirName, root);
+    size_t failures = 0;
+    for (const auto& [rel, st] : entries) {
+        if (archive.failed()) break; // finish() reports it
+        const std::string name = m_sourceDirName + '/' + rel;
+        if (S_ISDIR(st.st_mode)) {
+            archive.addDirectory(name, st);
+        } else if (S_ISREG(st.st_mode)) {
+            const int fd = openat(src_fd, rel.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+            if (fd < 0) {
+                print::warn("Failed to open '{}': {}", rel, std::strerror(errno));
+                ++failures;
+                continue;
+            }
+            if (!archive.addFile(fd, name, st)) {
+                print::warn("Failed to read '{}'", rel);
+                ++failures;
+            }
+            close(fd);
+        } else if (S_ISLNK(st.st_mode)) {
+            std::string target(static_cast<size_t>(st.st_size) + 1, '\0');
+            const ssize_t len = readlinkat(src_fd, rel.c_str(), target.data(), target.size());
+            if (len < 0) {
+                ++failures;
+                continue;
+            }
+            target.resize(static_cast<size_t>(len));
+            archive.addSymlink(name, target, st);
+        }
+    }
+    close(src_fd);
+
+    if (!archive.finish()) {
+        print::error("Failed to write archive '{}'", m_backupPath.string());
+        return;
+    }
+    m_stats.files = static_cast<uint64_t>(std::ranges::count_if(entries, [](const Entry& e) { return !S_ISDIR(e.st.st_mode); }));
+    m_stats.bytes = archive.inputBytes();
+    m_stats.outputBytes = archive.outputBytes();
+    print::info("Archived {} entries ({} threads)", entries.size() + 1, threads);
+    if (failures > 0) {
+        print::error("Failed to archive {} entries", failures);
     }
 }
 
-void ProjectCloner::printFinalSummary() const {
+void ProjectCloner::printFinalSummary() {
+    const profile::ScopedTimer timer(profile::Phase::Verify);
     if (!std::filesystem::exists(m_backupPath)) {
         print::error("Verification failed: Backup file/directory not found.");
         return;
     }
 
-    std::error_code ec;
-    const uintmax_t size_bytes = m_compress ?
-        std::filesystem::file_size(m_backupPath, ec) :
-        0; // Calculating dir size is slow, we'll skip for rsync
-
-    std::string size_str;
-    if (!ec && size_bytes > 0) {
-        size_str = " (" + std::to_string(size_bytes / 1024) + " KB)";
+    // Every engine counts as it goes; only measure the tree if nothing was counted
+    if (!m_compress && m_stats.files == 0) {
+        const TreeSize size = measure_tree(m_backupPath);
+        m_stats.files = size.files;
+        m_stats.bytes = size.bytes;
     }
 
-    print::success("Clean backup created successfully {}", size_str);
+    const double seconds = std::max(m_stats.seconds, 1e-6);
+    print::success("Clean backup created successfully ({}, {} files)", formatBytes(m_stats.bytes), m_stats.files);
+    if (m_compress) {
+        print::info("  Archive size: {} ({:.1f}% of input)", formatBytes(m_stats.outputBytes),
+                    m_stats.bytes ? 100.0 * static_cast<double>(m_stats.outputBytes) / static_cast<double>(m_stats.bytes) : 0.0);
+    }
+    print::info("  Took {:.2f}s: {:.1f} MB/s, {:.0f} files/s", m_stats.seconds,
+                static_cast<double>(m_stats.bytes) / 1e6 / seconds, static_cast<double>(m_stats.files) / seconds);
     print::info("  Excluded: build dirs, compiled files, IDE configs, etc.");
 
     const auto rel_path = std::filesystem::relative(m_backupPath, m_currentPath);
@@ -185,12 +704,14 @@ void ProjectCloner::printFinalSummary() const {
 }
 
 void ProjectCloner::showUsage() const {
-    std::cout << "Usage: dvk " << m_commandName << " [-c] [suffix]" << std::endl;
+    print::flush(); // Keep queued log lines ahead of the usage text
+    std::cout << "Usage: dvk " << m_commandName << " [-c|-i] [suffix]" << std::endl;
     std::cout << "" << std::endl;
     std::cout << "Backs up current directory excluding build/temp files." << std::endl;
     std::cout << "" << std::endl;
     std::cout << "Options:" << std::endl;
     std::cout << "  -c, --compress    Create a compressed .tar.gz archive instead of a directory copy." << std::endl;
+    std::cout << "  -i, --incremental Reuse unchanged files from the previous incremental snapshot." << std::endl;
     std::cout << "  -h, --help        Show this help message." << std::endl;
     std::cout << "" << std::endl;
     std::cout << "Examples:" << std::endl;
@@ -198,4 +719,5 @@ void ProjectCloner::showUsage() const {
     std::cout << "  dvk " << m_commandName << " -c                # Creates compressed backup with timestamp" << std::endl;
     std::cout << "  dvk " << m_commandName << " my-version      # Creates clean backup with custom suffix" << std::endl;
     std::cout << "  dvk " << m_commandName << " -c my-version   # Creates compressed backup with custom suffix" << std::endl;
+    std::cout << "  dvk " << m_commandName << " -i                # Snapshot, copying only what changed" << std::endl;
 }
\ No newline at end of file
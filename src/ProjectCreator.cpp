@@ -4,18 +4,52 @@
 #include <cstdlib> // for getenv, system
 #include <algorithm> // for std::all_of
 #include <cctype>    // for std::isalnum
-#include <fstream>
 #include <regex>
 #include <stdexcept>
-
+#include <atomic>
+#include <chrono>
+#include <cstdio> // for renameat2
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BatchManifest.hpp"
+#include "filebatch.hpp"
 #include "print.hpp"
 #include "input.hpp"
-#include "findNreplace.hpp"
+#include "profile.hpp"
+#include "template.hpp"
+#include "TemplatePack.hpp"
+
 // Anonymous namespace for internal linkage (private to this file)
+namespace {
+    // Placeholders the generated files use; values are passed in this order
+    constexpr tmpl::Names<3> kPlaceholders = {"_PROJECT_NAME_", "_MAIN_FILE_", "_SOURCES_"};
+    // Packed templates can be overridden at run time, so their length has no fixed bound
+    using ProjectTemplate = tmpl::Template<kPlaceholders.size(), tmpl::kDynamic>;
+
+    // A template from the pack, split into segments the first time it is used
+    const ProjectTemplate& projectTemplate(const std::string_view name) {
+        static std::mutex mutex;
+        static std::unordered_map<std::string_view, ProjectTemplate> parsed; // Keyed by the callers' string literals
+        std::lock_guard lock(mutex);
+        auto it = parsed.find(name);
+        if (it == parsed.end()) {
+            const std::string_view text = TemplatePack::instance().get(name);
+            it = parsed.emplace(name, ProjectTemplate(text, kPlaceholders)).first;
+        }
+        return it->second;
+    }
+}
 
 // --- Public Methods ---
 
-void ProjectCreator::run() {
+int ProjectCreator::run() {
     try {
         print::info("DVK Project Creation Wizard");
 
@@ -37,12 +71,16 @@ void ProjectCreator::run() {
     } catch (const std::runtime_error& e) {
         if (std::string(e.what()) == "Cancelled") {
              print::warn("Cancelled.");
-        } else {
-            print::error("An unexpected error occurred: {}", std::string(e.what()));
+             return 0;
         }
+        // Includes a template override that can't be used
+        print::error("Failed to create project '{}': {}", m_projectName, e.what());
+        return 1;
     } catch (const std::exception& e) {
         print::error("An unexpected error occurred: {}", std::string(e.what()));
+        return 1;
     }
+    return 0;
 }
 
 
@@ -216,390 +254,361 @@ bool ProjectCreator::confirmSettings() {
 
 // 2. Project & File System Operations
 
-void ProjectCreator::writeFile(const fs::path& path, const std::string& content) {
-    std::ofstream file(path);
-    if (!file) {
-        throw std::runtime_error("Failed to open file for writing: " + path.string());
-    }
-    file << content;
-}
-
-void ProjectCreator::createProjectStructure() const {
-    if (fs::exists(m_projectPath)) {
-        print::warn("Directory {} exists.", m_projectPath.string());
-    }
-    print::info("Creating project at: {}", std::string(m_projectPath.string()));
-
-    fs::create_directory(m_projectPath);
-    const fs::path srcDir = m_projectPath / "src";
-    fs::create_directory(srcDir);
-
-    // Create main file(s)
+std::vector<ProjectCreator::ProjectFile> ProjectCreator::projectFiles() const {
+    std::vector<ProjectFile> files;
+    // Main file(s)
     if (m_projectType == ProjectType::C || m_projectType == ProjectType::Mixed) {
-        writeFile(srcDir / "main.c", getCMainContent());
-        print::success("Created main.c");
+        files.push_back({true, "main.c", getCMainContent()});
     }
     if (m_projectType == ProjectType::CPP || m_projectType == ProjectType::Mixed) {
-        writeFile(srcDir / "main.cpp", getCPPMainContent());
-        print::success("Created main.cpp");
+        files.push_back({true, "main.cpp", getCPPMainContent()});
     }
     if (m_projectType == ProjectType::ASM) {
-        writeFile(srcDir / "main.s", getASMMainContent());
-        print::success("Created main.s");
+        files.push_back({true, "main.s", getASMMainContent()});
     }
 
-    // Create build system files
+    // Build system files
     switch (m_buildSystem) {
         case BuildSystem::Make:
-            writeFile(m_projectPath / "Makefile", getMakefileContent());
-            print::success("Created Makefile");
+            files.push_back({false, "Makefile", getMakefileContent()});
             break;
         case BuildSystem::CMake:
-            writeFile(m_projectPath / "CMakeLists.txt", getCMakeContent());
-            print::success("Created CMakeLists.txt");
+            files.push_back({false, "CMakeLists.txt", getCMakeContent()});
             break;
         case BuildSystem::Autocc:
-            writeFile(m_projectPath / "autocc.toml", getAutoccContent());
-            print::success("Created autocc.toml");
+            files.push_back({false, "autocc.toml", getAutoccContent()});
             break;
         case BuildSystem::Manual:
         default:
             break; // Do nothing
     }
 
-    // Create .gitignore and README
-    writeFile(m_projectPath / ".gitignore", getGitignoreContent());
-    print::success("Created .gitignore");
-    writeFile(m_projectPath / "README.md", getReadmeContent());
-    print::success("Created README.md");
+    files.push_back({false, ".gitignore", getGitignoreContent()});
+    files.push_back({false, "README.md", getReadmeContent()});
+    return files;
 }
 
-// 3. Content Generation
-
-std::string ProjectCreator::getCMainContent() {
-    return R"(#include <stdio.h>
-#include <stdlib.h>
+void ProjectCreator::createProjectStructure() const {
+    const profile::ScopedTimer timer(profile::Phase::None, "dvk create");
+    if (fs::exists(m_projectPath)) {
+        // The finished tree is renamed into place, which needs the name to be free:
+        // an empty directory is replaced, anything else is left alone
+        std::error_code ec;
+        if (!fs::is_directory(m_projectPath) || !fs::is_empty(m_projectPath, ec) || !fs::remove(m_projectPath, ec)) {
+            throw std::runtime_error(m_projectPath.string() + " already exists and is not an empty directory");
+        }
+        print::warn("Replacing empty directory {}.", m_projectPath.string());
+    }
+    print::info("Creating project at: {}", std::string(m_projectPath.string()));
 
-int main(int argc, char *argv[]) {
-    printf("Hello, World!\n");
-    return 0;
-}
-)";
+    const int workspace_fd = open(m_workspacePath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (workspace_fd < 0) {
+        throw std::runtime_error(fmt::format("cannot open {}: {}", m_workspacePath.string(), std::strerror(errno)));
+    }
+    size_t files = 0;
+    uint64_t bytes = 0;
+    try {
+        const std::string stage = stageProject(workspace_fd, files, bytes);
+        // Contents reach the disk before the rename makes them visible
+        if (syncfs(workspace_fd) != 0) print::warn("syncfs failed: {}", std::strerror(errno));
+        publishProject(workspace_fd, stage);
+        fsync(workspace_fd);
+    } catch (...) {
+        close(workspace_fd);
+        throw;
+    }
+    close(workspace_fd);
+    print::success("Created {} files ({} bytes)", files, bytes);
 }
 
-std::string ProjectCreator::getCPPMainContent() {
-    return R"(#include <iostream>
+std::string ProjectCreator::stageProject(const int workspace_fd, size_t& files, uint64_t& bytes) const {
+    // Hidden and beside the target, so moving it into place is a single rename
+    static std::atomic<unsigned> s_counter{0};
+    std::string stage;
+    for (int attempt = 0;; ++attempt) {
+        stage = fmt::format(".{}.dvk-stage.{}.{}", m_projectName, getpid(), s_counter.fetch_add(1));
+        if (mkdirat(workspace_fd, stage.c_str(), 0755) == 0) break;
+        if (errno != EEXIST || attempt == 16) {
+            throw std::runtime_error(fmt::format("cannot create staging directory: {}", std::strerror(errno)));
+        }
+    }
 
-int main(int argc, char *argv[]) {
-    print::info( "Hello, World!" << std::endl;
-    return 0;
-}
-)";
-}
+    int project_fd = -1;
+    int src_fd = -1;
+    try {
+        project_fd = openat(workspace_fd, stage.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (project_fd < 0 || mkdirat(project_fd, "src", 0755) != 0 ||
+            (src_fd = openat(project_fd, "src", O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0) {
+            throw std::runtime_error(fmt::format("cannot create src: {}", std::strerror(errno)));
+        }
 
-std::string ProjectCreator::getASMMainContent() {
-    return R"(.section .data
-    msg: .ascii "Hello, World!\n"
-    msg_len = . - msg
-
-.section .text
-    .global _start
-
-_start:
-    # write system call
-    mov $1, %rax        # sys_write
-    mov $1, %rdi        # stdout
-    mov $msg, %rsi      # message
-    mov $msg_len, %rdx  # length
-    syscall
-
-    # exit system call
-    mov $60, %rax       # sys_exit
-    mov $0, %rdi        # exit status
-    syscall
-)";
+        const std::vector<ProjectFile> contents = projectFiles();
+        std::vector<FileWrite> writes;
+        writes.reserve(contents.size());
+        for (const auto& [inSrc, name, content] : contents) {
+            writes.push_back({inSrc ? src_fd : project_fd, name, content});
+        }
+        if (write_files(writes) != 0) {
+            const auto failed = std::ranges::find_if(writes, [](const FileWrite& w) { return w.error != 0; });
+            throw std::runtime_error(fmt::format("cannot write {}: {}", failed->name, std::strerror(failed->error)));
+        }
+        for (const auto& w : writes) bytes += w.data.size();
+        files += writes.size();
+    } catch (...) {
+        if (src_fd >= 0) close(src_fd);
+        if (project_fd >= 0) close(project_fd);
+        std::error_code ec;
+        fs::remove_all(m_workspacePath / stage, ec);
+        throw;
+    }
+    close(src_fd);
+    close(project_fd);
+    return stage;
 }
 
-std::string ProjectCreator::getMakefileContent() const {
-    std::string content;
-    switch (m_projectType) {
-        case ProjectType::C:
-            content = R"(CC = gcc
-CFLAGS = -Wall -Wextra -std=c99 -g
-TARGET = _PROJECT_NAME_
-SRCDIR = src
-OBJDIR = build
-SOURCES = $(wildcard $(SRCDIR)/*.c)
-OBJECTS = $(SOURCES:$(SRCDIR)/%.c=$(OBJDIR)/%.o)
-
-.PHONY: all clean run debug install
-
-all: $(OBJDIR) $(TARGET)
-
-$(TARGET): $(OBJECTS)
-	$(CC) $(OBJECTS) -o $@
-
-$(OBJDIR)/%.o: $(SRCDIR)/%.c
-	$(CC) $(CFLAGS) -c $< -o $@
-
-$(OBJDIR):
-	mkdir -p $(OBJDIR)
-
-clean:
-	rm -rf $(OBJDIR) $(TARGET)
-
-run: all
-	./$(TARGET)
-
-debug: CFLAGS += -DDEBUG
-debug: all
-
-install: all
-	cp $(TARGET) /usr/local/bin/
-)";
-            break;
-        case ProjectType::CPP:
-            content = R"(CXX = g++
-CXXFLAGS = -Wall -Wextra -std=c++17 -g
-TARGET = _PROJECT_NAME_
-SRCDIR = src
-OBJDIR = build
-SOURCES = $(wildcard $(SRCDIR)/*.cpp)
-OBJECTS = $(SOURCES:$(SRCDIR)/%.cpp=$(OBJDIR)/%.o)
-
-.PHONY: all clean run debug install
-
-all: $(OBJDIR) $(TARGET)
-
-$(TARGET): $(OBJECTS)
-	$(CXX) $(OBJECTS) -o $@
-
-$(OBJDIR)/%.o: $(SRCDIR)/%.cpp
-	$(CXX) $(CXXFLAGS) -c $< -o $@
-
-$(OBJDIR):
-	mkdir -p $(OBJDIR)
-
-clean:
-	rm -rf $(OBJDIR) $(TARGET)
-
-run: all
-	./$(TARGET)
-
-debug: CXXFLAGS += -DDEBUG
-debug: all
-
-install: all
-	cp $(TARGET) /usr/local/bin/
-)";
-            break;
-        case ProjectType::Mixed: // FIX: Added support for mixed projects
-            content = R"(CC = gcc
-CXX = g++
-CFLAGS = -Wall -Wextra -std=c99 -g
-CXXFLAGS = -Wall -Wextra -std=c++17 -g
-TARGET = _PROJECT_NAME_
-SRCDIR = src
-OBJDIR = build
-
-C_SOURCES = $(wildcard $(SRCDIR)/*.c)
-CXX_SOURCES = $(wildcard $(SRCDIR)/*.cpp)
-OBJECTS = $(C_SOURCES:$(SRCDIR)/%.c=$(OBJDIR)/%.o) $(CXX_SOURCES:$(SRCDIR)/%.cpp=$(OBJDIR)/%.o)
-
-.PHONY: all clean run debug install
-
-all: $(OBJDIR) $(TARGET)
-
-$(TARGET): $(OBJECTS)
-	$(CXX) $(OBJECTS) -o $@
-
-$(OBJDIR)/%.o: $(SRCDIR)/%.c
-	$(CC) $(CFLAGS) -c $< -o $@
-
-$(OBJDIR)/%.o: $(SRCDIR)/%.cpp
-	$(CXX) $(CXXFLAGS) -c $< -o $@
-
-$(OBJDIR):
-	mkdir -p $(OBJDIR)
+void ProjectCreator::publishProject(const int workspace_fd, const std::string& stage) const {
+    const char* name = m_projectName.c_str();
+    int rc = renameat2(workspace_fd, stage.c_str(), workspace_fd, name, RENAME_NOREPLACE);
+    if (rc != 0 && errno == EINVAL) {
+        // No RENAME_NOREPLACE on this filesystem: check first, then rename
+        struct stat st{};
+        if (fstatat(workspace_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+            errno = EEXIST;
+        } else {
+            rc = renameat(workspace_fd, stage.c_str(), workspace_fd, name);
+        }
+    }
+    if (rc != 0) {
+        const int err = errno;
+        std::error_code ec;
+        fs::remove_all(m_workspacePath / stage, ec);
+        throw std::runtime_error(err == EEXIST ? "directory already exists"
+                                               : fmt::format("cannot move into place: {}", std::strerror(err)));
+    }
+}
 
-clean:
-	rm -rf $(OBJDIR) $(TARGET)
+int ProjectCreator::runBatch(const fs::path& manifest, const unsigned threads) {
+    const profile::ScopedTimer timer(profile::Phase::None, "dvk create --batch");
+    const auto start = std::chrono::steady_clock::now();
 
-run: all
-	./$(TARGET)
+    BatchManifest parsed;
+    std::string error;
+    if (!parsed.load(manifest, error)) {
+        print::error("{}", error);
+        return 1;
+    }
 
-debug: CFLAGS += -DDEBUG
-debug: CXXFLAGS += -DDEBUG
-debug: all
+    // Everything is validated before anything is created
+    const BatchManifest::Table* defaults = parsed.table("defaults");
+    const auto setting = [defaults](const BatchManifest::Table& entry, const std::string_view key) {
+        const std::string* value = entry.find(key);
+        if (!value && defaults) value = defaults->find(key);
+        return value ? *value : std::string();
+    };
+    const auto checkKeys = [&](const BatchManifest::Table& table) {
+        bool ok = true;
+        for (const auto& [key, value] : table.values) {
+            if (key != "name" && key != "type" && key != "build" && key != "workspace") {
+                print::error("{}:{}: unknown key '{}' in [{}]", manifest.string(), table.line, key, table.name);
+                ok = false;
+            }
+        }
+        return ok;
+    };
 
-install: all
-	cp $(TARGET) /usr/local/bin/
-)";
-            break;
-        case ProjectType::ASM:
-            content = R"(AS = as
-LD = ld
-TARGET = _PROJECT_NAME_
-SRCDIR = src
-OBJDIR = build
-SOURCES = $(wildcard $(SRCDIR)/*.s)
-OBJECTS = $(SOURCES:$(SRCDIR)/%.s=$(OBJDIR)/%.o)
+    bool valid = !defaults || checkKeys(*defaults);
+    std::vector<ProjectCreator> projects;
+    std::vector<fs::path> workspaces;
+    std::vector<size_t> workspaceOf; // Index into workspaces, per project
+    std::unordered_set<std::string> targets;
+    for (const BatchManifest::Table* entry : parsed.array("project")) {
+        const auto invalid = [&](const std::string& why) {
+            print::error("{}:{}: {}", manifest.string(), entry->line, why);
+            valid = false;
+        };
+        if (!checkKeys(*entry)) {
+            valid = false;
+            continue;
+        }
 
-.PHONY: all clean run install
+        ProjectCreator project;
+        project.m_projectName = setting(*entry, "name");
+        project.m_projectType = parseProjectType(setting(*entry, "type"));
+        project.m_buildSystem = parseBuildSystem(setting(*entry, "build"));
+        const std::string workspace = setting(*entry, "workspace");
+        std::error_code ec;
+        project.m_workspacePath = fs::absolute(expandUserPath(workspace.empty() ? "." : workspace), ec).lexically_normal();
+        project.m_projectPath = project.m_workspacePath / project.m_projectName;
+
+        if (!isValidProjectName(project.m_projectName)) {
+            invalid(fmt::format("invalid project name '{}'", project.m_projectName));
+        } else if (project.m_projectType == ProjectType::Unknown) {
+            invalid(fmt::format("unknown type '{}' (c, cpp, mixed, asm)", setting(*entry, "type")));
+        } else if (project.m_buildSystem == BuildSystem::Unknown) {
+            invalid(fmt::format("unknown build '{}' (make, cmake, autocc, manual)", setting(*entry, "build")));
+        } else if (!fs::is_directory(project.m_workspacePath)) {
+            invalid(fmt::format("workspace '{}' is not a directory", project.m_workspacePath.string()));
+        } else if (!targets.insert(project.m_projectPath.string()).second) {
+            invalid(fmt::format("'{}' is listed twice", project.m_projectPath.string()));
+        } else if (fs::exists(project.m_projectPath, ec)) {
+            invalid(fmt::format("'{}' already exists", project.m_projectPath.string()));
+        } else {
+            const auto it = std::ranges::find(workspaces, project.m_workspacePath);
+            workspaceOf.push_back(static_cast<size_t>(it - workspaces.begin()));
+            if (it == workspaces.end()) workspaces.push_back(project.m_workspacePath);
+            projects.push_back(std::move(project));
+        }
+    }
+    if (!valid) {
+        print::error("Nothing was created.");
+        return 1;
+    }
+    if (projects.empty()) {
+        print::warn("'{}' lists no [[project]] entries.", manifest.string());
+        return 0;
+    }
 
-all: $(OBJDIR) $(TARGET)
+    // Each workspace is opened once; projects are created relative to it
+    std::vector<int> workspaceFds;
+    for (const auto& ws : workspaces) {
+        workspaceFds.push_back(open(ws.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (workspaceFds.back() < 0) {
+            print::error("Cannot open workspace '{}': {}", ws.string(), std::strerror(errno));
+            for (const int fd : workspaceFds) if (fd >= 0) close(fd);
+            return 1;
+        }
+    }
 
-$(TARGET): $(OBJECTS)
-	$(LD) $(OBJECTS) -o $@
+    struct Outcome {
+        size_t files = 0;
+        uint64_t bytes = 0;
+        double ms = 0;
+        std::string stage; // Staging directory, until published
+        std::string error;
+    };
+    std::vector<Outcome> outcomes(projects.size());
+    std::atomic<size_t> next{0};
+    const auto worker = [&] {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < projects.size();) {
+            const auto begin = std::chrono::steady_clock::now();
+            try {
+                outcomes[i].stage = projects[i].stageProject(workspaceFds[workspaceOf[i]], outcomes[i].files, outcomes[i].bytes);
+            } catch (const std::exception& e) {
+                outcomes[i].error = e.what();
+            }
+            outcomes[i].ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        }
+    };
+    const size_t count = std::min<size_t>(threads ? threads : std::max(1u, std::thread::hardware_concurrency()),
+                                          projects.size());
+    print::info("Creating {} projects on {} threads", projects.size(), count);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < count; ++i) workers.emplace_back(worker);
+    worker();
+    for (auto& w : workers) w.join();
+
+    // Everything is staged: one syncfs per filesystem makes it durable, then each
+    // project is renamed into place and the workspace directories are synced
+    const auto publishStart = std::chrono::steady_clock::now();
+    std::vector<dev_t> synced;
+    for (const int fd : workspaceFds) {
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || std::ranges::find(synced, st.st_dev) != synced.end()) continue;
+        synced.push_back(st.st_dev);
+        if (syncfs(fd) != 0) print::warn("syncfs failed: {}", std::strerror(errno));
+    }
+    for (size_t i = 0; i < projects.size(); ++i) {
+        if (!outcomes[i].error.empty()) continue;
+        try {
+            projects[i].publishProject(workspaceFds[workspaceOf[i]], outcomes[i].stage);
+        } catch (const std::exception& e) {
+            outcomes[i].error = e.what();
+        }
+    }
+    for (const int fd : workspaceFds) {
+        fsync(fd);
+        close(fd);
+    }
+    const double publishMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - publishStart).count();
+
+    size_t created = 0;
+    size_t files = 0;
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < projects.size(); ++i) {
+        const Outcome& o = outcomes[i];
+        if (!o.error.empty()) {
+            print::error("{:<24} failed after {:.2f} ms: {}", projects[i].m_projectName, o.ms, o.error);
+            continue;
+        }
+        print::success("{:<24} {} files, {} bytes staged in {:.2f} ms  {}", projects[i].m_projectName, o.files, o.bytes, o.ms,
+                       projects[i].m_projectPath.string());
+        ++created;
+        files += o.files;
+        bytes += o.bytes;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    print::info("Created {}/{} projects ({} files, {} bytes) in {:.1f} ms ({:.1f} ms syncing and renaming), "
+                "{:.0f} projects/s", created, projects.size(), files, bytes, seconds * 1e3, publishMs,
+                static_cast<double>(created) / seconds);
+    return created == projects.size() ? 0 : 1;
+}
 
-$(OBJDIR)/%.o: $(SRCDIR)/%.s
-	$(AS) $< -o $@
+// 3. Content Generation
+// File contents come from the template pack (templates/, or a user override).
 
-$(OBJDIR):
-	mkdir -p $(OBJDIR)
+std::string ProjectCreator::getCMainContent() {
+    return std::string(TemplatePack::instance().get("main/c"));
+}
 
-clean:
-	rm -rf $(OBJDIR) $(TARGET)
+std::string ProjectCreator::getCPPMainContent() {
+    return std::string(TemplatePack::instance().get("main/cpp"));
+}
 
-run: all
-	./$(TARGET)
+std::string ProjectCreator::getASMMainContent() {
+    return std::string(TemplatePack::instance().get("main/asm"));
+}
 
-install: all
-	cp $(TARGET) /usr/local/bin/
-)";
-            break;
-        default: break;
+std::string ProjectCreator::getMakefileContent() const {
+    switch (m_projectType) {
+        case ProjectType::C: return projectTemplate("make/c").render({m_projectName, {}, {}});
+        case ProjectType::CPP: return projectTemplate("make/cpp").render({m_projectName, {}, {}});
+        case ProjectType::Mixed: return projectTemplate("make/mixed").render({m_projectName, {}, {}});
+        case ProjectType::ASM: return projectTemplate("make/asm").render({m_projectName, {}, {}});
+        default: return {};
     }
-    findAndReplaceAll(content, "_PROJECT_NAME_", m_projectName);
-    return content;
 }
 
 std::string ProjectCreator::getCMakeContent() const {
-    std::string content;
     switch (m_projectType) {
-        case ProjectType::C:
-            content = R"(cmake_minimum_required(VERSION 3.10)
-project(_PROJECT_NAME_ C)
-
-set(CMAKE_C_STANDARD 99)
-set(CMAKE_C_STANDARD_REQUIRED ON)
-set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -Wall -Wextra -g")
-
-file(GLOB SOURCES "src/*.c")
-
-add_executable(_PROJECT_NAME_ ${SOURCES})
-
-set(CMAKE_RUNTIME_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR})
-)";
-            break;
-        case ProjectType::CPP:
-             content = R"(cmake_minimum_required(VERSION 3.10)
-project(_PROJECT_NAME_ CXX)
-
-set(CMAKE_CXX_STANDARD 17)
-set(CMAKE_CXX_STANDARD_REQUIRED ON)
-set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -Wall -Wextra -g")
-
-file(GLOB SOURCES "src/*.cpp")
-
-add_executable(_PROJECT_NAME_ ${SOURCES})
-
-set(CMAKE_RUNTIME_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR})
-)";
-            break;
-        case ProjectType::Mixed: // FIX: Added support for mixed projects
-            content = R"(cmake_minimum_required(VERSION 3.10)
-project(_PROJECT_NAME_ C CXX)
-
-set(CMAKE_C_STANDARD 99)
-set(CMAKE_C_STANDARD_REQUIRED ON)
-set(CMAKE_CXX_STANDARD 17)
-set(CMAKE_CXX_STANDARD_REQUIRED ON)
-
-set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -Wall -Wextra -g")
-set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -Wall -Wextra -g")
-
-file(GLOB SOURCES "src/*.c" "src/*.cpp")
-
-add_executable(_PROJECT_NAME_ ${SOURCES})
-
-set(CMAKE_RUNTIME_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR})
-)";
-            break;
-        default: break; // ASM isn't handled by this simple CMake template
+        case ProjectType::C: return projectTemplate("cmake/c").render({m_projectName, {}, {}});
+        case ProjectType::CPP: return projectTemplate("cmake/cpp").render({m_projectName, {}, {}});
+        case ProjectType::Mixed: return projectTemplate("cmake/mixed").render({m_projectName, {}, {}});
+        default: return {}; // ASM isn't handled by this simple CMake template
     }
-    findAndReplaceAll(content, "_PROJECT_NAME_", m_projectName);
-    return content;
 }
 
 std::string ProjectCreator::getAutoccContent() const {
-    std::string main_file;
-    std::string sources = "[ ";
+    std::string_view main_file;
+    std::string_view sources = "[ ]";
 
     if (m_projectType == ProjectType::C) {
         main_file = "'./src/main.c'";
-        sources += "'./src/main.c' ]";
+        sources = "[ './src/main.c' ]";
     } else if (m_projectType == ProjectType::CPP) {
         main_file = "'./src/main.cpp'";
-        sources += "'./src/main.cpp' ]";
+        sources = "[ './src/main.cpp' ]";
     } else if (m_projectType == ProjectType::Mixed) { // FIX: Added support for mixed projects
         main_file = "'./src/main.cpp'"; // Link with C++
-        sources += "'./src/main.c', './src/main.cpp' ]";
+        sources = "[ './src/main.c', './src/main.cpp' ]";
     } else if (m_projectType == ProjectType::ASM) {
         main_file = "'./src/main.s'";
-        sources += "'./src/main.s' ]";
-    }
-
-    std::string content = R"(# CONFIGURATION FILE 'autocc.toml' IS WRITTEN MANUALLY BY DVK, NOT BY AUTOCC. EDIT WITH CAUTION.
-[compilers]
-as = 'as'
-cc = 'clang'
-cxx = 'clang++'
-
-[paths]
-exclude_patterns = []
-include_dirs = []
-
-[project]
-build_dir = "build"
-default_target = "_PROJECT_NAME_"
-
-[[targets]]
-name = "_PROJECT_NAME_"
-main_file = _MAIN_FILE_
-sources = _SOURCES_
-output_name = "_PROJECT_NAME_"
-cflags = "-Wall -Wextra -g"
-cxxflags = "-Wall -Wextra -g"
-)";
-
-    findAndReplaceAll(content, "_PROJECT_NAME_", m_projectName);
-    findAndReplaceAll(content, "_MAIN_FILE_", main_file);
-    findAndReplaceAll(content, "_SOURCES_", sources);
-    return content;
+        sources = "[ './src/main.s' ]";
+    }
+    return projectTemplate("autocc/default").render({m_projectName, main_file, sources});
 }
 
-std::string ProjectCreator::getGitignoreContent() {
-    return R"(# Build artifacts
-build/
-*.o
-*.obj
-*.exe
-*.out
-a.out
-_PROJECT_NAME_
-
-# IDE files
-.vscode/
-.idea/
-*.swp
-*.swo
-compile_commands.json
-
-# System files
-.DS_Store
-Thumbs.db
-)";
+std::string ProjectCreator::getGitignoreContent() const {
+    return projectTemplate("gitignore/default").render({m_projectName, {}, {}});
 }
 
 std::string ProjectCreator::getReadmeContent() const {
@@ -638,8 +647,7 @@ std::string ProjectCreator::getReadmeContent() const {
             content += "\n## Run\n\n```bash\n./_PROJECT_NAME_\n```\n";
             break;
     }
-    findAndReplaceAll(content, "_PROJECT_NAME_", m_projectName);
-    return content;
+    return tmpl::render(content, kPlaceholders, {m_projectName, {}, {}});
 }
 
 
@@ -655,6 +663,22 @@ std::string ProjectCreator::projectTypeToString(const ProjectType type) {
     }
 }
 
+ProjectCreator::ProjectType ProjectCreator::parseProjectType(const std::string_view text) {
+    if (text == "c") return ProjectType::C;
+    if (text == "cpp" || text == "c++") return ProjectType::CPP;
+    if (text == "mixed") return ProjectType::Mixed;
+    if (text == "asm") return ProjectType::ASM;
+    return ProjectType::Unknown;
+}
+
+ProjectCreator::BuildSystem ProjectCreator::parseBuildSystem(const std::string_view text) {
+    if (text == "make") return BuildSystem::Make;
+    if (text == "cmake") return BuildSystem::CMake;
+    if (text == "autocc") return BuildSystem::Autocc;
+    if (text == "manual" || text == "none") return BuildSystem::Manual;
+    return BuildSystem::Unknown;
+}
+
 std::string ProjectCreator::buildSystemToString(const BuildSystem system) {
     switch (system) {
         case BuildSystem::Make: return "Makefile";
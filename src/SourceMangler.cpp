@@ -0,0 +1,522 @@
+// SourceMangler.cpp
+#include "SourceMangler.hpp"
+#include "ctoken.hpp"
+#include "filebatch.hpp"
+#include "hash.hpp"
+#include "perfect_hash.hpp"
+#include "print.hpp"
+#include "profile.hpp"
+#include "walker.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Never renamed: C keywords, the libc calls and entry points scripts/mangle.py keeps
+const std::unordered_set<std::string_view> kReserved = {
+    "auto", "break", "case", "char", "const", "continue", "default", "do",
+    "double", "else", "enum", "extern", "float", "for", "goto", "if",
+    "int", "long", "register", "return", "short", "signed", "sizeof", "static",
+    "struct", "switch", "typedef", "union", "unsigned", "void", "volatile", "while",
+    "printf", "malloc", "free", "memcpy", "strlen", "strcmp",
+    "kmain", "_start", "kernel_main"
+};
+
+const std::vector<std::string> kKernelProtected = {
+    "kmain", "_start", "kernel_main", "interrupt_handler",
+    "page_fault_handler", "timer_interrupt", "keyboard_interrupt"
+};
+
+// Words that can come right before `name(...)` in a statement that declares nothing
+const std::unordered_set<std::string_view> kNotAType = {
+    "return", "else", "goto", "case", "sizeof", "do", "_Alignof", "alignof"
+};
+
+constexpr const char* kMapFile = "_mangling_map.json";
+
+bool readFile(const fs::path& path, std::string& out) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    out.resize(static_cast<size_t>(st.st_size));
+    size_t done = 0;
+    while (done < out.size()) {
+        const ssize_t n = read(fd, out.data() + done, out.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += static_cast<size_t>(n);
+    }
+    out.resize(done);
+    close(fd);
+    return true;
+}
+
+// The functions src declares or defines, first occurrence first: `type name(...) {` or
+// `type name(...);`, with any number of '*' between type and name when the type starts
+// the statement, and any `static type name(...)`. Parentheses are matched, so function-pointer parameters don't
+// hide a declaration. Comments, literals and preprocessor lines are skipped.
+std::vector<std::string> extractNames(const std::string_view src) {
+    std::vector<ctok::Token> tokens;
+    ctok::Lexer lexer(src);
+    for (ctok::Token tok{}; lexer.next(tok);) {
+        if (tok.kind != ctok::Kind::Comment && !tok.directive) tokens.push_back(tok);
+    }
+
+    std::vector<std::string> names;
+    std::unordered_set<std::string_view> seen;
+    const auto identifier = [&](const size_t i) { return tokens[i].kind == ctok::Kind::Identifier; };
+    for (size_t paren = 2; paren < tokens.size(); ++paren) {
+        if (!tokens[paren].is(src, '(') || !identifier(paren - 1)) continue;
+        size_t type = paren - 2;
+        while (type > 0 && tokens[type].is(src, '*')) --type;
+        if (!identifier(type) || kNotAType.contains(tokens[type].text(src))) continue;
+        // With a '*' in between this may be `a * call(b)`: only a declaration if the words
+        // before it open a statement, at the start of the file or after ';', '{' or '}'
+        if (type + 2 < paren) {
+            size_t first = type;
+            while (first > 0 && identifier(first - 1) && !kNotAType.contains(tokens[first - 1].text(src))) --first;
+            const bool opens = first == 0 || tokens[first - 1].is(src, ';') || tokens[first - 1].is(src, '{') ||
+                               tokens[first - 1].is(src, '}');
+            if (!opens) continue;
+        }
+
+        const bool is_static = type > 0 && tokens[type - 1].kind == ctok::Kind::Identifier &&
+                               tokens[type - 1].text(src) == "static";
+        if (!is_static) {
+            size_t end = paren;
+            for (int depth = 0; end < tokens.size(); ++end) {
+                if (tokens[end].is(src, '(')) ++depth;
+                else if (tokens[end].is(src, ')') && --depth == 0) break;
+            }
+            if (end + 1 >= tokens.size() || !(tokens[end + 1].is(src, '{') || tokens[end + 1].is(src, ';'))) continue;
+        }
+        if (const std::string_view name = tokens[paren - 1].text(src); seen.insert(name).second) {
+            names.emplace_back(name);
+        }
+    }
+    return names;
+}
+
+// Directives whose text is not code: a name there is a path or a message
+const std::unordered_set<std::string_view> kTextDirectives = {"include", "include_next", "import", "error", "warning", "line"};
+
+// Rewrites src in one pass: every use of a mapped name becomes its mangled name, be it a
+// call, a definition or a function used as a value, in code and in macros. A struct
+// member that shares the name is renamed too, at its declaration and at every access, so
+// the two stay consistent. Comments, literals and #include-like lines are left alone.
+std::string rewrite(const std::string_view src, const PerfectHash& table,
+                    const std::vector<std::pair<std::string, std::string>>& mapping, size_t& renamed) {
+    std::string out;
+    out.reserve(src.size() + src.size() / 16);
+    size_t copied = 0; // src is in out up to here
+    bool directive_name = false; // The next identifier names a directive
+    bool text_line = false;      // Inside a directive in kTextDirectives
+    ctok::Lexer lexer(src);
+    for (ctok::Token tok{}; lexer.next(tok);) {
+        if (tok.first) {
+            directive_name = tok.directive;
+            text_line = false;
+        }
+        if (tok.kind != ctok::Kind::Identifier || text_line) continue;
+        if (directive_name) {
+            directive_name = false;
+            text_line = kTextDirectives.contains(tok.text(src));
+            continue;
+        }
+        const uint32_t index = table.find(tok.text(src));
+        if (index == PerfectHash::npos) continue;
+
+        out.append(src, copied, tok.begin - copied);
+        out += mapping[index].second;
+        copied = tok.end;
+        ++renamed;
+    }
+    out.append(src, copied);
+    return out;
+}
+
+// Whether src uses any of the names in table outside comments and literals
+bool mentions(const std::string_view src, const PerfectHash& table) {
+    ctok::Lexer lexer(src);
+    for (ctok::Token tok{}; lexer.next(tok);) {
+        if (tok.kind == ctok::Kind::Identifier && table.find(tok.text(src)) != PerfectHash::npos) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+SourceMangler::SourceMangler(const int argc, char* argv[]) : m_argc(argc), m_argv(argv) {}
+
+int SourceMangler::run() {
+    const profile::ScopedTimer timer(profile::Phase::None, "dvk mangle");
+    if (!parseArguments()) return 1;
+    const auto start = std::chrono::steady_clock::now();
+
+    if (!collectFiles()) return 1;
+    if (!m_rebuild && m_previous.load(SymbolMap::pathFor(m_outputDir))) {
+        print::debug("Loaded {} names and {} files from {}", m_previous.symbols(), m_previous.files(),
+                     SymbolMap::pathFor(m_outputDir).string());
+    }
+    print::info("Mangling {} files from '{}' into '{}' ({} threads)", m_files.size(), m_sourceDir.string(),
+                m_outputDir.string(), m_threads);
+    extractAll();
+    buildMapping();
+    const bool ok = rewriteAll() && saveMapping();
+
+    const auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    print::info("Mapping saved to: {}", (m_outputDir / kMapFile).string());
+    print::info("Total functions mangled: {}", m_mapping.size());
+    if (!ok) return 1;
+    print::success("Mangled {} files in {:.1f} ms", m_files.size(), ms);
+    return 0;
+}
+
+void SourceMangler::showUsage() const {
+    print::info("Usage: dvk mangle <source-dir> [options]");
+    print::info("");
+    print::info("Options:");
+    print::info("  -o, --output <dir>          Output directory (default: <source-dir>_mangled)");
+    print::info("  --protect <name>...         Functions to keep");
+    print::info("  --extensions <ext>...       File extensions to process (default: .c .h)");
+    print::info("  --seed <n>                  Seed the name generator for reproducible output");
+    print::info("  -j <threads>                Worker threads (default: one per core)");
+    print::info("  --rebuild                   Ignore names and hashes saved by earlier runs");
+}
+
+bool SourceMangler::parseArguments() {
+    // Skip the program name and the subcommand itself
+    const std::vector<std::string> args(m_argv + std::min(m_argc, 2), m_argv + m_argc);
+    bool seeded = false;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        const bool has_value = i + 1 < args.size();
+        if (arg == "-h" || arg == "--help") {
+            showUsage();
+            return false;
+        }
+        if ((arg == "-o" || arg == "--output") && has_value) {
+            m_outputDir = args[++i];
+        } else if (arg == "--protect" || arg == "--extensions") {
+            // Like argparse's nargs='*': everything up to the next option
+            if (arg == "--extensions") m_extensions.clear();
+            while (i + 1 < args.size() && args[i + 1].rfind('-', 0) != 0) {
+                if (arg == "--protect") m_protected.insert(args[++i]);
+                else m_extensions.push_back(args[++i]);
+            }
+        } else if (arg == "--seed" && has_value) {
+            const std::string& value = args[++i];
+            uint64_t seed = 0;
+            if (const auto [end, err] = std::from_chars(value.data(), value.data() + value.size(), seed);
+                err != std::errc() || end != value.data() + value.size()) {
+                print::error("Invalid seed '{}'", value);
+                return false;
+            }
+            m_random.seed(seed);
+            seeded = true;
+        } else if (arg == "--rebuild") {
+            m_rebuild = true;
+        } else if (arg == "-j" && has_value) {
+            m_threads = static_cast<unsigned>(std::max(0, std::atoi(args[++i].c_str())));
+        } else if (arg.rfind('-', 0) == 0) {
+            print::error("Unknown option: {}", arg);
+            showUsage();
+            return false;
+        } else if (m_sourceDir.empty()) {
+            m_sourceDir = arg;
+        } else {
+            print::error("Too many arguments: '{}'", arg);
+            showUsage();
+            return false;
+        }
+    }
+
+    if (m_sourceDir.empty()) {
+        showUsage();
+        return false;
+    }
+    if (!fs::is_directory(m_sourceDir)) {
+        print::error("Source directory '{}' does not exist", m_sourceDir.string());
+        return false;
+    }
+    if (m_outputDir.empty()) {
+        m_outputDir = m_sourceDir.lexically_normal().string();
+        if (m_outputDir.has_filename()) m_outputDir += "_mangled";
+        else m_outputDir = m_outputDir.parent_path().string() + "_mangled";
+    }
+    if (m_threads == 0) m_threads = DirWalker::default_threads();
+    if (!seeded) m_random.seed(std::random_device{}());
+    m_protected.insert(kKernelProtected.begin(), kKernelProtected.end());
+    return true;
+}
+
+bool SourceMangler::collectFiles() {
+    const profile::ScopedTimer timer(profile::Phase::Walk);
+    // An output directory inside the source tree must not be mangled again
+    std::error_code ec;
+    const fs::path source = fs::weakly_canonical(m_sourceDir, ec);
+    const fs::path output = fs::weakly_canonical(m_outputDir, ec);
+    const fs::path inside = output.lexically_relative(source);
+    const std::string skip = !inside.empty() && *inside.begin() != ".." ? inside.generic_string() : std::string();
+
+    std::vector<std::vector<std::string>> chunks(DirWalker::default_threads());
+    WalkOptions options;
+    options.threads = static_cast<unsigned>(chunks.size());
+    options.on_error = [this](const std::string& rel, const int err) {
+        print::warn("Cannot read '{}': {}", (m_sourceDir / rel).string(), std::strerror(err));
+    };
+    DirWalker walker(std::move(options));
+    walker.walk(m_sourceDir, [&](const WalkEntry& entry) {
+        if (entry.is_dir()) return skip.empty() || entry.rel_path() != skip;
+        if (!entry.is_file()) return true;
+        const bool wanted = std::ranges::any_of(m_extensions, [&](const std::string& ext) {
+            return entry.name.size() >= ext.size() && entry.name.ends_with(ext);
+        });
+        if (wanted) chunks[entry.worker].push_back(entry.rel_path());
+        return true;
+    });
+
+    std::vector<std::string> rels;
+    for (auto& chunk : chunks) std::ranges::move(chunk, std::back_inserter(rels));
+    // Sorted, so the mapping (and with a fixed seed, the output) doesn't depend on the walk
+    std::ranges::sort(rels);
+    m_files.reserve(rels.size());
+    for (auto& rel : rels) m_files.push_back({std::move(rel), {}});
+    return true;
+}
+
+void SourceMangler::extractAll() {
+    const profile::ScopedTimer timer(profile::Phase::None, "extract");
+    std::atomic<size_t> next{0};
+    const auto worker = [&] {
+        std::string content;
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < m_files.size();) {
+            SourceFile& file = m_files[i];
+            if (!readFile(m_sourceDir / file.rel, content)) continue; // Reported by rewriteAll
+            file.read = true;
+            file.hash = Xxh64::of(content);
+            // Same contents as last time: the saved map already knows what it declares
+            if (SymbolMap::FileRecord record; m_previous.findFile(file.rel, record) && record.hash == file.hash) {
+                file.changed = false;
+                for (const uint32_t symbol : record.symbols) {
+                    if (std::string name(m_previous.name(symbol)); !name.empty() && isMangleable(name)) {
+                        file.names.push_back(std::move(name));
+                    }
+                }
+                continue;
+            }
+            for (auto& name : extractNames(content)) {
+                if (isMangleable(name)) file.names.push_back(std::move(name));
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < m_threads; ++t) workers.emplace_back(worker);
+    worker();
+    for (auto& t : workers) t.join();
+}
+
+bool SourceMangler::isMangleable(const std::string& name) const {
+    return !kReserved.contains(name) && !m_protected.contains(name);
+}
+
+void SourceMangler::buildMapping() {
+    std::unordered_set<std::string> originals;
+    for (const auto& file : m_files) {
+        for (const auto& name : file.names) {
+            if (originals.insert(name).second) m_mapping.emplace_back(name, std::string());
+        }
+    }
+    // Every name handed out before stays taken, so a retired function can come back as itself
+    std::unordered_set<std::string> taken;
+    for (uint32_t i = 0; i < m_previous.symbols(); ++i) taken.emplace(m_previous.mangled(i));
+    for (auto& [original, mangled] : m_mapping) {
+        const uint32_t before = m_previous.findSymbol(original);
+        if (before != SymbolMap::npos && !m_previous.active(before)) m_changedNames.push_back(original);
+        if (before != SymbolMap::npos && !m_previous.mangled(before).empty() &&
+            !originals.contains(std::string(m_previous.mangled(before)))) {
+            mangled = m_previous.mangled(before);
+            ++m_reused;
+            continue;
+        }
+        if (before != SymbolMap::npos && m_previous.active(before)) m_changedNames.push_back(original);
+        // Unique, and never an existing name or keyword
+        do {
+            mangled = generateName(original.size());
+        } while (kReserved.contains(mangled) || originals.contains(mangled) || !taken.insert(mangled).second);
+        if (before == SymbolMap::npos) m_changedNames.push_back(original);
+    }
+    for (uint32_t i = 0; i < m_previous.symbols(); ++i) {
+        std::string original(m_previous.name(i));
+        if (original.empty() || originals.contains(original)) continue;
+        if (m_previous.active(i)) m_changedNames.push_back(original);
+        m_retired.emplace_back(std::move(original), m_previous.mangled(i));
+    }
+}
+
+std::string SourceMangler::generateName(const size_t length) {
+    static constexpr std::string_view kHex = "0123456789abcdef";
+    static constexpr std::string_view kAlnum = "abcdefghijklmnopqrstuvwxyz0123456789";
+    const auto pick = [this](const std::string_view chars, const size_t count) {
+        std::string s;
+        for (size_t i = 0; i < count; ++i) s += chars[m_random() % chars.size()];
+        return s;
+    };
+    const auto between = [this](const unsigned low, const unsigned high) { return low + m_random() % (high - low + 1); };
+
+    // The four styles of scripts/mangle.py: hex, Itanium-like, mixed and compiler-internal
+    switch (m_random() % 4) {
+        case 0: return "_func_" + pick(kHex, 8);
+        case 1: return fmt::format("__ZN{}{}E", length, pick(kAlnum, 8));
+        case 2: return "_k" + pick(kAlnum, 4) + "_fn_" + pick(kAlnum, 4);
+        default:
+            switch (m_random() % 4) {
+                case 0: return fmt::format("__builtin_{}", between(1000, 9999));
+                case 1: return fmt::format("_internal_func_{}", between(100, 999));
+                case 2: return fmt::format("__kern_impl_{}", between(10, 99));
+                default: return fmt::format("_sys_call_impl_{}", between(1, 256));
+            }
+    }
+}
+
+bool SourceMangler::rewriteAll() {
+    const profile::ScopedTimer timer(profile::Phase::None, "rewrite");
+    std::vector<std::string_view> keys;
+    keys.reserve(m_mapping.size());
+    for (const auto& [original, mangled] : m_mapping) keys.emplace_back(original);
+    const PerfectHash table(std::move(keys));
+    // An unchanged file only needs a new output if it uses one of these
+    const PerfectHash changed_names(std::vector<std::string_view>(m_changedNames.begin(), m_changedNames.end()));
+
+    std::error_code ec;
+    std::set<fs::path> dirs{m_outputDir};
+    for (const auto& file : m_files) dirs.insert(m_outputDir / fs::path(file.rel).parent_path());
+    for (const auto& dir : dirs) {
+        if (fs::create_directories(dir, ec); ec) {
+            print::error("Failed to create '{}': {}", dir.string(), ec.message());
+            return false;
+        }
+    }
+    const int out_fd = open(m_outputDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (out_fd < 0) {
+        print::error("Failed to open '{}': {}", m_outputDir.string(), std::strerror(errno));
+        return false;
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> failed{0};
+    std::atomic<size_t> renamed{0};
+    std::atomic<size_t> skipped{0};
+    std::atomic<uint64_t> bytes{0};
+    const auto worker = [&] {
+        std::string content;
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < m_files.size();) {
+            const SourceFile& file = m_files[i];
+            const bool up_to_date = !file.changed && faccessat(out_fd, file.rel.c_str(), F_OK, 0) == 0;
+            if (up_to_date && m_changedNames.empty()) {
+                ++skipped;
+                continue;
+            }
+            if (!readFile(m_sourceDir / file.rel, content)) {
+                print::warn("Cannot read '{}': {}", (m_sourceDir / file.rel).string(), std::strerror(errno));
+                ++failed;
+                continue;
+            }
+            if (up_to_date && !mentions(content, changed_names)) {
+                ++skipped;
+                continue;
+            }
+            size_t count = 0;
+            const std::string mangled = rewrite(content, table, m_mapping, count);
+            if (const int err = filebatch::detail::writeSync(out_fd, file.rel.c_str(), mangled, 0644, O_CREAT | O_TRUNC)) {
+                print::warn("Cannot write '{}': {}", (m_outputDir / file.rel).string(), std::strerror(err));
+                ++failed;
+                continue;
+            }
+            renamed += count;
+            bytes += mangled.size();
+            LOG_DEBUG("Mangled: {} -> {} ({} names)", (m_sourceDir / file.rel).string(), (m_outputDir / file.rel).string(), count);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < m_threads; ++t) workers.emplace_back(worker);
+    worker();
+    for (auto& t : workers) t.join();
+    removeStale(out_fd);
+    close(out_fd);
+
+    if (skipped > 0 || m_reused > 0) {
+        print::info("{} of {} files unchanged, {} of {} names kept from the previous run", skipped.load(), m_files.size(),
+                    m_reused, m_mapping.size());
+    }
+    print::info("Renamed {} uses of {} functions ({} bytes written)", renamed.load(), m_mapping.size(), bytes.load());
+    if (failed > 0) {
+        print::error("Failed to mangle {} files", failed.load());
+        return false;
+    }
+    return true;
+}
+
+bool SourceMangler::saveMapping() const {
+    // Same layout as json.dump(mapping, indent=2); names are plain identifiers, nothing to escape
+    std::string json = "{";
+    for (size_t i = 0; i < m_mapping.size(); ++i) {
+        json += fmt::format("{}\n  \"{}\": \"{}\"", i ? "," : "", m_mapping[i].first, m_mapping[i].second);
+    }
+    json += m_mapping.empty() ? "}" : "\n}";
+
+    const fs::path path = m_outputDir / kMapFile;
+    if (const int err = filebatch::detail::writeSync(AT_FDCWD, path.c_str(), json, 0644, O_CREAT | O_TRUNC)) {
+        print::error("Failed to write '{}': {}", path.string(), std::strerror(err));
+        return false;
+    }
+
+    // Current names first, in the order above, then retired ones so they stay reserved
+    SymbolMap::Writer writer;
+    std::unordered_map<std::string_view, uint32_t> index;
+    for (const auto& [original, mangled] : m_mapping) index.emplace(original, writer.addSymbol(original, mangled, true));
+    for (const auto& [original, mangled] : m_retired) writer.addSymbol(original, mangled, false);
+    std::vector<uint32_t> symbols;
+    for (const auto& file : m_files) {
+        if (!file.read) continue;
+        symbols.clear();
+        for (const auto& name : file.names) symbols.push_back(index.at(name));
+        writer.addFile(file.rel, file.hash, symbols);
+    }
+    const fs::path map_path = SymbolMap::pathFor(m_outputDir);
+    if (const int err = writer.save(map_path)) {
+        print::error("Failed to write '{}': {}", map_path.string(), std::strerror(err));
+        return false;
+    }
+    return true;
+}
+
+void SourceMangler::removeStale(const int out_fd) const {
+    // Outputs of source files that are gone; m_files is sorted by path
+    for (uint32_t i = 0; i < m_previous.files(); ++i) {
+        const std::string_view rel = m_previous.filePath(i);
+        // Never follow a damaged map out of the output directory
+        if (rel.empty() || rel.front() == '/' || rel.find("..") != std::string_view::npos ||
+            std::ranges::binary_search(m_files, rel, {}, [](const SourceFile& f) { return std::string_view(f.rel); })) {
+            continue;
+        }
+        if (unlinkat(out_fd, std::string(rel).c_str(), 0) == 0) LOG_DEBUG("Removed stale output: {}", rel);
+    }
+}
@@ -0,0 +1,216 @@
+// SymbolMap.cpp
+#include "SymbolMap.hpp"
+#include "filebatch.hpp"
+#include "hash.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr char kMagic[8] = {'D', 'V', 'K', 'S', 'Y', 'M', '1', '\n'};
+    constexpr const char* kFileName = "_mangling_map.dvkmap";
+    constexpr size_t kSymbolWords = 6;
+    constexpr size_t kFileWords = 8;
+
+    uint32_t hash32(const std::string_view key) {
+        return static_cast<uint32_t>(Xxh64::of(key));
+    }
+
+    // Power of two with at least twice as many slots as entries
+    uint32_t slotCount(const size_t entries) {
+        uint32_t slots = 1;
+        while (slots < entries * 2) slots <<= 1;
+        return slots;
+    }
+
+    // Open-addressed table of index + 1 for entries whose hash is at word hash_word of each record
+    std::vector<uint32_t> buildTable(const std::vector<uint32_t>& records, const size_t words, const size_t hash_word) {
+        const size_t count = records.size() / words;
+        std::vector<uint32_t> table(slotCount(count), 0);
+        const uint32_t mask = static_cast<uint32_t>(table.size() - 1);
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t slot = records[i * words + hash_word] & mask;
+            while (table[slot] != 0) slot = (slot + 1) & mask;
+            table[slot] = i + 1;
+        }
+        return table;
+    }
+}
+
+std::filesystem::path SymbolMap::pathFor(const std::filesystem::path& output_dir) {
+    return output_dir / kFileName;
+}
+
+SymbolMap::~SymbolMap() {
+    if (m_data) munmap(m_data, m_size);
+}
+
+bool SymbolMap::load(const std::filesystem::path& path) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    // Only the header is checked here; offsets into the arena are checked on use
+    Header header{};
+    std::memcpy(&header, data, sizeof(header));
+    const auto power_of_two = [](const uint64_t n) { return n != 0 && (n & (n - 1)) == 0; };
+    const uint64_t expected = sizeof(Header) +
+        4 * (uint64_t{header.symbol_count} * kSymbolWords + header.symbol_slots +
+             uint64_t{header.file_count} * kFileWords + header.file_slots + header.ref_count) + header.arena_size;
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || expected != static_cast<uint64_t>(st.st_size) ||
+        !power_of_two(header.symbol_slots) || !power_of_two(header.file_slots) ||
+        header.symbol_slots < header.symbol_count || header.file_slots < header.file_count) {
+        munmap(data, static_cast<size_t>(st.st_size));
+        return false;
+    }
+
+    if (m_data) munmap(m_data, m_size);
+    m_data = data;
+    m_size = static_cast<size_t>(st.st_size);
+    m_symbolCount = header.symbol_count;
+    m_symbolSlots = header.symbol_slots;
+    m_fileCount = header.file_count;
+    m_fileSlots = header.file_slots;
+    m_refCount = header.ref_count;
+    m_symbols = reinterpret_cast<const uint32_t*>(static_cast<const char*>(data) + sizeof(Header));
+    m_symbolTable = m_symbols + size_t{m_symbolCount} * kSymbolWords;
+    m_files = m_symbolTable + m_symbolSlots;
+    m_fileTable = m_files + size_t{m_fileCount} * kFileWords;
+    m_refs = m_fileTable + m_fileSlots;
+    m_arena = std::string_view(reinterpret_cast<const char*>(m_refs + m_refCount), header.arena_size);
+    return true;
+}
+
+std::string_view SymbolMap::text(const uint32_t offset, const uint32_t size) const {
+    if (offset > m_arena.size() || size > m_arena.size() - offset) return {};
+    return m_arena.substr(offset, size);
+}
+
+uint32_t SymbolMap::findSymbol(const std::string_view name) const {
+    if (m_symbolCount == 0) return npos;
+    const uint32_t h = hash32(name);
+    const uint32_t mask = m_symbolSlots - 1;
+    // At most half full, so a free slot always ends the probe
+    for (uint32_t slot = h & mask, probes = 0; probes < m_symbolSlots; slot = (slot + 1) & mask, ++probes) {
+        const uint32_t entry = m_symbolTable[slot];
+        if (entry == 0 || entry > m_symbolCount) return npos;
+        const uint32_t* symbol = m_symbols + size_t{entry - 1} * kSymbolWords;
+        if (symbol[4] == h && text(symbol[0], symbol[1]) == name) return entry - 1;
+    }
+    return npos;
+}
+
+std::string_view SymbolMap::name(const uint32_t symbol) const {
+    if (symbol >= m_symbolCount) return {};
+    const uint32_t* s = m_symbols + size_t{symbol} * kSymbolWords;
+    return text(s[0], s[1]);
+}
+
+std::string_view SymbolMap::mangled(const uint32_t symbol) const {
+    if (symbol >= m_symbolCount) return {};
+    const uint32_t* s = m_symbols + size_t{symbol} * kSymbolWords;
+    return text(s[2], s[3]);
+}
+
+bool SymbolMap::active(const uint32_t symbol) const {
+    return symbol < m_symbolCount && (m_symbols[size_t{symbol} * kSymbolWords + 5] & 1) != 0;
+}
+
+bool SymbolMap::findFile(const std::string_view rel, FileRecord& out) const {
+    if (m_fileCount == 0) return false;
+    const uint32_t h = hash32(rel);
+    const uint32_t mask = m_fileSlots - 1;
+    for (uint32_t slot = h & mask, probes = 0; probes < m_fileSlots; slot = (slot + 1) & mask, ++probes) {
+        const uint32_t entry = m_fileTable[slot];
+        if (entry == 0 || entry > m_fileCount) return false;
+        const uint32_t* file = m_files + size_t{entry - 1} * kFileWords;
+        if (file[6] != h || text(file[2], file[3]) != rel) continue;
+        if (file[4] > m_refCount || file[5] > m_refCount - file[4]) return false;
+        std::memcpy(&out.hash, file, sizeof(out.hash));
+        out.symbols = std::span<const uint32_t>(m_refs + file[4], file[5]);
+        return true;
+    }
+    return false;
+}
+
+std::string_view SymbolMap::filePath(const uint32_t file) const {
+    if (file >= m_fileCount) return {};
+    const uint32_t* f = m_files + size_t{file} * kFileWords;
+    return text(f[2], f[3]);
+}
+
+uint32_t SymbolMap::Writer::append(const std::string_view text) {
+    const auto offset = static_cast<uint32_t>(m_arena.size());
+    m_arena.append(text);
+    return offset;
+}
+
+uint32_t SymbolMap::Writer::addSymbol(const std::string_view name, const std::string_view mangled, const bool active) {
+    const auto index = static_cast<uint32_t>(m_symbols.size() / kSymbolWords);
+    const uint32_t name_offset = append(name);
+    const uint32_t mangled_offset = append(mangled);
+    m_symbols.insert(m_symbols.end(), {name_offset, static_cast<uint32_t>(name.size()), mangled_offset,
+                                       static_cast<uint32_t>(mangled.size()), hash32(name), active ? 1u : 0u});
+    return index;
+}
+
+void SymbolMap::Writer::addFile(const std::string_view rel, const uint64_t hash, const std::span<const uint32_t> symbols) {
+    uint32_t words[2];
+    std::memcpy(words, &hash, sizeof(hash));
+    const uint32_t path_offset = append(rel);
+    m_files.insert(m_files.end(), {words[0], words[1], path_offset, static_cast<uint32_t>(rel.size()),
+                                   static_cast<uint32_t>(m_refs.size()), static_cast<uint32_t>(symbols.size()),
+                                   hash32(rel), 0u});
+    m_refs.insert(m_refs.end(), symbols.begin(), symbols.end());
+}
+
+int SymbolMap::Writer::save(const std::filesystem::path& path) const {
+    const std::vector<uint32_t> symbol_table = buildTable(m_symbols, kSymbolWords, 4);
+    const std::vector<uint32_t> file_table = buildTable(m_files, kFileWords, 6);
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.symbol_count = static_cast<uint32_t>(m_symbols.size() / kSymbolWords);
+    header.symbol_slots = static_cast<uint32_t>(symbol_table.size());
+    header.file_count = static_cast<uint32_t>(m_files.size() / kFileWords);
+    header.file_slots = static_cast<uint32_t>(file_table.size());
+    header.ref_count = static_cast<uint32_t>(m_refs.size());
+    header.arena_size = static_cast<uint32_t>(m_arena.size());
+
+    std::string out;
+    out.reserve(sizeof(header) + 4 * (m_symbols.size() + symbol_table.size() + m_files.size() + file_table.size() +
+                                      m_refs.size()) + m_arena.size());
+    const auto put = [&out](const void* data, const size_t size) { out.append(static_cast<const char*>(data), size); };
+    put(&header, sizeof(header));
+    for (const auto* words : {&m_symbols, &symbol_table, &m_files, &file_table, &m_refs}) {
+        put(words->data(), words->size() * sizeof(uint32_t));
+    }
+    out += m_arena;
+
+    // Unique per process and call, so two mangle runs on one output directory can't write
+    // into the same temporary file; whichever renames last leaves a complete map
+    static std::atomic<unsigned> s_saves{0};
+    const std::string tmp = path.string() + "." + std::to_string(getpid()) + "." + std::to_string(s_saves++) + ".tmp";
+    if (const int err = filebatch::detail::writeSync(AT_FDCWD, tmp.c_str(), out, 0644, O_CREAT | O_TRUNC)) {
+        unlink(tmp.c_str());
+        return err;
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        const int err = errno;
+        unlink(tmp.c_str());
+        return err;
+    }
+    return 0;
+}
@@ -0,0 +1,340 @@
+// TarArchiver.cpp
+#include "TarArchiver.hpp"
+#include "print.hpp"
+#include "profile.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace {
+    constexpr size_t kBlock = 512;
+    constexpr size_t kRecord = 20 * kBlock;          // GNU tar's default record size
+    constexpr size_t kChunkSize = 1024 * 1024;       // Uncompressed bytes per gzip member
+    constexpr size_t kOutBufSize = 4 * 1024 * 1024;  // Compressed bytes per write()
+    constexpr uint64_t kMaxOctal11 = 077777777777ULL; // Largest value of a 12-byte octal field
+
+    // Zero-padded octal in width - 1 digits and a NUL; callers clamp value to fit
+    void putOctal(char* field, const size_t width, uint64_t value) {
+        field[width - 1] = '\0';
+        for (size_t i = width - 1; i-- > 0; value >>= 3) field[i] = static_cast<char>('0' + (value & 7));
+    }
+
+    // Splits a long path into ustar prefix/name parts; false if it cannot be represented.
+    bool splitUstarName(const std::string& path, std::string& prefix, std::string& name) {
+        if (path.size() <= 100) {
+            prefix.clear();
+            name = path;
+            return true;
+        }
+        for (size_t slash = path.find('/'); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+            if (slash > 155) break;
+            if (path.size() - slash - 1 <= 100 && slash + 1 < path.size()) {
+                prefix = path.substr(0, slash);
+                name = path.substr(slash + 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string paxRecord(const std::string& key, const std::string& value) {
+        // The length prefix counts its own digits, so grow it until it is stable
+        const size_t body = key.size() + value.size() + 3; // ' ', '=', '\n'
+        size_t len = body + 1;
+        while (std::to_string(len).size() + body != len) ++len;
+        return std::to_string(len) + ' ' + key + '=' + value + '\n';
+    }
+}
+
+TarArchiver::TarArchiver(std::filesystem::path output, const unsigned threads, const int level)
+    : m_output(std::move(output)),
+      m_threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      m_level(level) {}
+
+TarArchiver::~TarArchiver() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_workers) t.join();
+    if (m_fd >= 0) close(m_fd);
+}
+
+bool TarArchiver::open() {
+    m_fd = ::open(m_output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        print::error("Cannot create archive '{}': {}", m_output.string(), std::strerror(errno));
+        return false;
+    }
+    m_chunk.reserve(kChunkSize);
+    m_outBuf.reserve(kOutBufSize);
+    for (unsigned i = 0; i < m_threads; ++i) {
+        m_workers.emplace_back([this] { worker(); });
+    }
+    return true;
+}
+
+void TarArchiver::addDirectory(const std::string& name, const struct stat& st) {
+    writeHeader(name.empty() || name.back() == '/' ? name : name + '/', st, '5', 0);
+}
+
+void TarArchiver::addSymlink(const std::string& name, const std::string& target, const struct stat& st) {
+    writeHeader(name, st, '2', 0, target);
+}
+
+bool TarArchiver::addFile(const int fd, const std::string& name, const struct stat& st) {
+    const auto size = static_cast<uint64_t>(st.st_size);
+    writeHeader(name, st, '0', size);
+
+    uint64_t remaining = size;
+    bool ok = true;
+    // Once the archive has failed nothing more reaches the disk, so stop reading
+    while (remaining > 0 && !m_failed) {
+        if (m_chunk.size() == kChunkSize) submitChunk();
+        // Read straight into the chunk buffer rather than through a bounce buffer
+        const size_t room = std::min<uint64_t>(kChunkSize - m_chunk.size(), remaining);
+        const size_t used = m_chunk.size();
+        m_chunk.resize(used + room);
+        const ssize_t n = ok ? read(fd, m_chunk.data() + used, room) : 0;
+        profile::count(profile::Phase::Copy, ok ? 1 : 0, n > 0 ? static_cast<uint64_t>(n) : 0);
+        if (n < 0 && errno == EINTR) {
+            m_chunk.resize(used);
+            continue;
+        }
+        if (n <= 0) {
+            // The header already promised size bytes: keep the archive valid with zeros
+            if (n < 0) ok = false;
+            std::fill(m_chunk.begin() + static_cast<std::ptrdiff_t>(used), m_chunk.end(), 0);
+        } else {
+            m_chunk.resize(used + static_cast<size_t>(n));
+        }
+        const size_t added = m_chunk.size() - used;
+        remaining -= added;
+        m_streamOffset += added;
+        m_inputBytes += added;
+    }
+    padToBlock();
+    return ok;
+}
+
+bool TarArchiver::finish() {
+    static constexpr unsigned char zeros[2 * kBlock] = {};
+    append(zeros, sizeof(zeros));
+    if (const size_t tail = m_streamOffset % kRecord; tail != 0) {
+        const std::vector<unsigned char> pad(kRecord - tail, 0);
+        append(pad.data(), pad.size());
+    }
+    if (!m_chunk.empty()) submitChunk();
+    while (!m_failed && m_nextWrite < m_nextSeq) {
+        writeCompleted(true);
+    }
+    const bool ok = !m_failed && flushOutput();
+    if (close(m_fd) != 0) m_failed = true;
+    m_fd = -1;
+    return ok && !m_failed;
+}
+
+void TarArchiver::writeHeader(const std::string& name, const struct stat& st, const char type, const uint64_t size,
+                              const std::string& link) {
+    std::vector<std::pair<std::string, std::string>> pax;
+    std::string prefix, short_name;
+    if (!splitUstarName(name, prefix, short_name)) {
+        pax.emplace_back("path", name);
+        short_name = name.substr(0, 100);
+        prefix.clear();
+    }
+    if (link.size() > 100) pax.emplace_back("linkpath", link);
+    if (size > kMaxOctal11) pax.emplace_back("size", std::to_string(size));
+    if (!pax.empty()) writePaxHeader(name, pax);
+
+    char h[kBlock] = {};
+    std::memcpy(h, short_name.data(), std::min<size_t>(short_name.size(), 100));
+    putOctal(h + 100, 8, st.st_mode & 07777);
+    putOctal(h + 108, 8, std::min<uint64_t>(st.st_uid, 07777777));
+    putOctal(h + 116, 8, std::min<uint64_t>(st.st_gid, 07777777));
+    putOctal(h + 124, 12, size > kMaxOctal11 ? 0 : size);
+    putOctal(h + 136, 12, static_cast<uint64_t>(std::max<time_t>(st.st_mtime, 0)));
+    h[156] = type;
+    std::memcpy(h + 157, link.data(), std::min<size_t>(link.size(), 100));
+    std::memcpy(h + 257, "ustar", 6);
+    std::memcpy(h + 263, "00", 2);
+    std::memcpy(h + 345, prefix.data(), std::min<size_t>(prefix.size(), 155));
+
+    std::memset(h + 148, ' ', 8);
+    unsigned sum = 0;
+    for (const char c : h) sum += static_cast<unsigned char>(c);
+    putOctal(h + 148, 7, sum);
+    h[155] = ' ';
+    append(h, sizeof(h));
+}
+
+void TarArchiver::writePaxHeader(const std::string& name, const std::vector<std::pair<std::string, std::string>>& records) {
+    std::string body;
+    for (const auto& [key, value] : records) body += paxRecord(key, value);
+
+    const std::string base = std::filesystem::path(name).filename().string();
+    const std::string pax_name = ("PaxHeaders/" + base).substr(0, 100);
+    char h[kBlock] = {};
+    std::memcpy(h, pax_name.data(), pax_name.size());
+    putOctal(h + 100, 8, 0644);
+    putOctal(h + 108, 8, 0);
+    putOctal(h + 116, 8, 0);
+    putOctal(h + 124, 12, body.size());
+    putOctal(h + 136, 12, 0);
+    h[156] = 'x';
+    std::memcpy(h + 257, "ustar", 6);
+    std::memcpy(h + 263, "00", 2);
+    std::memset(h + 148, ' ', 8);
+    unsigned sum = 0;
+    for (const char c : h) sum += static_cast<unsigned char>(c);
+    putOctal(h + 148, 7, sum);
+    h[155] = ' ';
+    append(h, sizeof(h));
+    append(body.data(), body.size());
+    padToBlock();
+}
+
+void TarArchiver::append(const void* data, size_t size) {
+    auto p = static_cast<const unsigned char*>(data);
+    m_streamOffset += size;
+    while (size > 0) {
+        if (m_chunk.size() == kChunkSize) submitChunk();
+        const size_t n = std::min(size, kChunkSize - m_chunk.size());
+        m_chunk.insert(m_chunk.end(), p, p + n);
+        p += n;
+        size -= n;
+    }
+}
+
+void TarArchiver::padToBlock() {
+    static constexpr unsigned char zeros[kBlock] = {};
+    if (const size_t tail = m_streamOffset % kBlock; tail != 0) append(zeros, kBlock - tail);
+}
+
+void TarArchiver::submitChunk() {
+    // Bound memory: at most two chunks per worker may be queued or compressed
+    while (!m_failed && m_nextSeq - m_nextWrite >= 2 * m_threads) {
+        writeCompleted(true);
+    }
+    if (m_failed) {
+        // Nothing will be written any more; drop the chunk rather than queue it unthrottled
+        m_chunk.clear();
+        return;
+    }
+    {
+        std::lock_guard lock(m_mutex);
+        Job& job = m_jobs[m_nextSeq];
+        job.raw.swap(m_chunk);
+        m_queue.push_back(m_nextSeq++);
+    }
+    m_cv.notify_all();
+    m_chunk.clear();
+    m_chunk.reserve(kChunkSize);
+    writeCompleted(false);
+}
+
+bool TarArchiver::writeCompleted(const bool wait_for_next) {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock(m_mutex);
+            auto it = m_jobs.find(m_nextWrite);
+            if (wait_for_next) {
+                m_cv.wait(lock, [&] { it = m_jobs.find(m_nextWrite); return it != m_jobs.end() && it->second.done; });
+            }
+            if (it == m_jobs.end() || !it->second.done) return true;
+            job = std::move(it->second);
+            m_jobs.erase(it);
+            ++m_nextWrite;
+        }
+        if (!job.ok || !writeOut(job.packed.data(), job.packed.size())) {
+            m_failed = true;
+            return false;
+        }
+        if (wait_for_next) return true;
+    }
+}
+
+bool TarArchiver::writeOut(const unsigned char* data, const size_t size) {
+    m_outBuf.insert(m_outBuf.end(), data, data + size);
+    m_outputBytes += size;
+    if (m_outBuf.size() < kOutBufSize) return true;
+
+    // Write whole multiples of the buffer size and keep the remainder for the next call
+    const size_t whole = m_outBuf.size() / kOutBufSize * kOutBufSize;
+    for (size_t done = 0; done < whole;) {
+        const ssize_t n = write(m_fd, m_outBuf.data() + done, whole - done);
+        profile::count(profile::Phase::Compress, 1, n > 0 ? static_cast<uint64_t>(n) : 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            print::error("Failed to write archive: {}", std::strerror(errno));
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    m_outBuf.erase(m_outBuf.begin(), m_outBuf.begin() + static_cast<std::ptrdiff_t>(whole));
+    return true;
+}
+
+bool TarArchiver::flushOutput() {
+    for (size_t done = 0; done < m_outBuf.size();) {
+        const ssize_t n = write(m_fd, m_outBuf.data() + done, m_outBuf.size() - done);
+        profile::count(profile::Phase::Compress, 1, n > 0 ? static_cast<uint64_t>(n) : 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            print::error("Failed to write archive: {}", std::strerror(errno));
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    m_outBuf.clear();
+    return true;
+}
+
+void TarArchiver::worker() {
+    while (true) {
+        uint64_t seq;
+        std::vector<unsigned char> raw;
+        {
+            std::unique_lock lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) return;
+            seq = m_queue.front();
+            m_queue.pop_front();
+            raw.swap(m_jobs[seq].raw);
+        }
+
+        Job job;
+        job.raw = std::move(raw);
+        const bool ok = compress(job, m_level);
+        {
+            std::lock_guard lock(m_mutex);
+            Job& slot = m_jobs[seq];
+            slot.packed = std::move(job.packed);
+            slot.ok = ok;
+            slot.done = true;
+        }
+        m_cv.notify_all();
+    }
+}
+
+bool TarArchiver::compress(Job& job, const int level) {
+    const profile::ScopedTimer timer(profile::Phase::Compress);
+    z_stream z{};
+    // windowBits 15 + 16 selects a gzip wrapper, making each chunk a complete member
+    if (deflateInit2(&z, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+    job.packed.resize(deflateBound(&z, job.raw.size()));
+    z.next_in = job.raw.data();
+    z.avail_in = static_cast<uInt>(job.raw.size());
+    z.next_out = job.packed.data();
+    z.avail_out = static_cast<uInt>(job.packed.size());
+    const int rc = deflate(&z, Z_FINISH);
+    job.packed.resize(z.total_out);
+    deflateEnd(&z);
+    return rc == Z_STREAM_END;
+}
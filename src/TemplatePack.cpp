@@ -0,0 +1,158 @@
+// TemplatePack.cpp
+#include "TemplatePack.hpp"
+#include "print.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+// Generated from templates/ by tools/packgen.cpp
+extern const unsigned char dvk_template_pack[];
+extern const size_t dvk_template_pack_size;
+
+namespace {
+    constexpr char kMagic[8] = {'D', 'V', 'K', 'T', 'P', 'K', '1', '\n'};
+    constexpr size_t kHeaderSize = sizeof(kMagic) + sizeof(uint32_t);
+    constexpr size_t kEntrySize = 5 * sizeof(uint32_t);
+
+    struct Entry {
+        uint32_t name_offset;
+        uint32_t name_size;
+        uint32_t data_offset;
+        uint32_t compressed_size;
+        uint32_t size;
+    };
+
+    uint32_t read32(const unsigned char* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t packCount() {
+        if (dvk_template_pack_size < kHeaderSize || std::memcmp(dvk_template_pack, kMagic, sizeof(kMagic)) != 0) return 0;
+        return read32(dvk_template_pack + sizeof(kMagic));
+    }
+
+    Entry packEntry(const uint32_t index) {
+        const unsigned char* p = dvk_template_pack + kHeaderSize + static_cast<size_t>(index) * kEntrySize;
+        return {read32(p), read32(p + 4), read32(p + 8), read32(p + 12), read32(p + 16)};
+    }
+
+    std::string_view entryName(const Entry& e) {
+        return {reinterpret_cast<const char*>(dvk_template_pack) + e.name_offset, e.name_size};
+    }
+}
+
+TemplatePack& TemplatePack::instance() {
+    static auto* pack = new TemplatePack();
+    return *pack;
+}
+
+TemplatePack::TemplatePack() {
+    if (const char* dirs = std::getenv("DVK_TEMPLATES")) {
+        std::string_view rest(dirs);
+        while (!rest.empty()) {
+            const size_t colon = rest.find(':');
+            if (const auto dir = rest.substr(0, colon); !dir.empty()) m_overrideDirs.emplace_back(dir);
+            rest.remove_prefix(colon == std::string_view::npos ? rest.size() : colon + 1);
+        }
+    }
+    if (const char* config = std::getenv("XDG_CONFIG_HOME"); config && *config) {
+        m_overrideDirs.push_back(std::filesystem::path(config) / "dvk" / "templates");
+    } else if (const char* home = std::getenv("HOME")) {
+        m_overrideDirs.push_back(std::filesystem::path(home) / ".config" / "dvk" / "templates");
+    }
+}
+
+void TemplatePack::indexOverrides() {
+    if (m_indexed) return;
+    m_indexed = true;
+    for (const auto& dir : m_overrideDirs) {
+        std::error_code ec;
+        if (!std::filesystem::is_directory(dir, ec)) continue;
+        for (auto it = std::filesystem::recursive_directory_iterator(dir, ec);
+             !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (!it->is_regular_file(ec)) continue;
+            // Earlier directories win
+            m_overrides.try_emplace(it->path().lexically_relative(dir).generic_string(), it->path());
+        }
+        if (ec) print::warn("Cannot read template directory '{}': {}", dir.string(), ec.message());
+    }
+}
+
+std::optional<std::string_view> TemplatePack::findBuiltin(const std::string_view name) {
+    if (const auto it = m_inflated.find(std::string(name)); it != m_inflated.end()) return it->second;
+
+    uint32_t low = 0;
+    uint32_t high = packCount();
+    while (low < high) {
+        const uint32_t mid = low + (high - low) / 2;
+        const Entry entry = packEntry(mid);
+        const std::string_view candidate = entryName(entry);
+        if (candidate < name) {
+            low = mid + 1;
+        } else if (name < candidate) {
+            high = mid;
+        } else {
+            std::string text(entry.size, '\0');
+            uLongf size = entry.size;
+            if (uncompress(reinterpret_cast<Bytef*>(text.data()), &size, dvk_template_pack + entry.data_offset,
+                           entry.compressed_size) != Z_OK || size != entry.size) {
+                throw std::runtime_error("corrupt built-in template '" + std::string(name) + "'");
+            }
+            return m_inflated.emplace(std::string(name), std::move(text)).first->second;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<std::string_view> TemplatePack::find(const std::string_view name) {
+    std::lock_guard lock(m_mutex);
+    indexOverrides();
+    const std::string key(name);
+    if (const auto it = m_mapped.find(key); it != m_mapped.end()) {
+        return std::string_view(static_cast<const char*>(it->second.data), it->second.size);
+    }
+    if (const auto it = m_overrides.find(key); it != m_overrides.end()) {
+        const int fd = open(it->second.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st{};
+        if (fd >= 0 && fstat(fd, &st) == 0) {
+            Mapping mapping{nullptr, static_cast<size_t>(st.st_size)};
+            // Empty files can't be mapped; they are empty templates
+            if (mapping.size > 0) mapping.data = mmap(nullptr, mapping.size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (mapping.data != MAP_FAILED) {
+                print::debug("Template '{}' from {}", name, it->second.string());
+                const Mapping& stored = m_mapped.emplace(key, mapping).first->second;
+                return std::string_view(static_cast<const char*>(stored.data), stored.size);
+            }
+        } else if (fd >= 0) {
+            close(fd);
+        }
+        print::warn("Cannot read template override '{}': {}", it->second.string(), std::strerror(errno));
+    }
+    return findBuiltin(name);
+}
+
+std::string_view TemplatePack::get(const std::string_view name) {
+    if (const auto text = find(name)) return *text;
+    throw std::runtime_error("unknown template '" + std::string(name) + "'");
+}
+
+std::vector<std::string> TemplatePack::names() {
+    std::lock_guard lock(m_mutex);
+    indexOverrides();
+    std::vector<std::string> all;
+    const uint32_t count = packCount();
+    for (uint32_t i = 0; i < count; ++i) all.emplace_back(entryName(packEntry(i)));
+    for (const auto& [name, path] : m_overrides) all.push_back(name);
+    std::ranges::sort(all);
+    all.erase(std::unique(all.begin(), all.end()), all.end());
+    return all;
+}
@@ -0,0 +1,110 @@
+// Build-time tool: packs the templates/ tree into a C++ source holding one byte array.
+//
+//   dvk_packgen <templates-dir> <output.cpp>
+//
+// The blob layout is described in include/TemplatePack.hpp. Each template is deflated
+// on its own, so dvk only inflates the ones a command actually uses.
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+    struct Item {
+        std::string name;
+        std::string data;
+        std::string compressed;
+    };
+
+    void put32(std::string& out, const uint32_t value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    bool deflateAll(const std::string& in, std::string& out) {
+        uLongf size = compressBound(static_cast<uLong>(in.size()));
+        out.resize(size);
+        if (compress2(reinterpret_cast<Bytef*>(out.data()), &size, reinterpret_cast<const Bytef*>(in.data()),
+                      static_cast<uLong>(in.size()), Z_BEST_COMPRESSION) != Z_OK) {
+            return false;
+        }
+        out.resize(size);
+        return true;
+    }
+}
+
+int main(const int argc, char* argv[]) {
+    if (argc != 3) {
+        std::fprintf(stderr, "Usage: %s <templates-dir> <output.cpp>\n", argv[0]);
+        return 2;
+    }
+    const fs::path root = argv[1];
+
+    std::vector<Item> items;
+    std::error_code ec;
+    for (const auto& entry : fs::recursive_directory_iterator(root, ec)) {
+        if (!entry.is_regular_file()) continue;
+        std::ifstream file(entry.path(), std::ios::binary);
+        Item item{entry.path().lexically_relative(root).generic_string(),
+                  std::string(std::istreambuf_iterator<char>(file), {}), {}};
+        if (!file.good() && !file.eof()) {
+            std::fprintf(stderr, "packgen: cannot read %s\n", entry.path().c_str());
+            return 1;
+        }
+        if (!deflateAll(item.data, item.compressed)) {
+            std::fprintf(stderr, "packgen: cannot compress %s\n", entry.path().c_str());
+            return 1;
+        }
+        items.push_back(std::move(item));
+    }
+    if (ec) {
+        std::fprintf(stderr, "packgen: cannot read %s: %s\n", root.c_str(), ec.message().c_str());
+        return 1;
+    }
+    // Sorted by name: the runtime finds entries by binary search
+    std::ranges::sort(items, {}, &Item::name);
+
+    constexpr char kMagic[8] = {'D', 'V', 'K', 'T', 'P', 'K', '1', '\n'};
+    constexpr size_t kEntrySize = 5 * sizeof(uint32_t);
+    std::string blob(kMagic, sizeof(kMagic));
+    put32(blob, static_cast<uint32_t>(items.size()));
+    size_t offset = blob.size() + items.size() * kEntrySize;
+    std::string payload;
+    for (const Item& item : items) {
+        put32(blob, static_cast<uint32_t>(offset + payload.size()));
+        put32(blob, static_cast<uint32_t>(item.name.size()));
+        payload += item.name;
+        put32(blob, static_cast<uint32_t>(offset + payload.size()));
+        put32(blob, static_cast<uint32_t>(item.compressed.size()));
+        put32(blob, static_cast<uint32_t>(item.data.size()));
+        payload += item.compressed;
+    }
+    blob += payload;
+
+    std::string out = "// Generated by tools/packgen.cpp from templates/. Do not edit.\n"
+                      "#include <cstddef>\n\n"
+                      "alignas(4) extern const unsigned char dvk_template_pack[] = {";
+    char byte[16];
+    for (size_t i = 0; i < blob.size(); ++i) {
+        std::snprintf(byte, sizeof(byte), "%s%u,", i % 24 ? "" : "\n    ", static_cast<unsigned char>(blob[i]));
+        out += byte;
+    }
+    out += "\n};\nextern const size_t dvk_template_pack_size = sizeof(dvk_template_pack);\n";
+
+    std::ofstream file(argv[2], std::ios::binary | std::ios::trunc);
+    file << out;
+    if (!file) {
+        std::fprintf(stderr, "packgen: cannot write %s\n", argv[2]);
+        return 1;
+    }
+    size_t raw = 0;
+    for (const Item& item : items) raw += item.data.size();
+    std::printf("packgen: %zu templates, %zu bytes -> %zu byte pack\n", items.size(), raw, blob.size());
+    return 0;
+}